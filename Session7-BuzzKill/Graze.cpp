@@ -3,6 +3,7 @@
 #include "Graze.h"
 #include "Entity.h"
 #include "Collidable.h"
+#include "TargetIndex.h"
 #include "Link.h"
 #include "Resource.h"
 
@@ -198,30 +199,11 @@ public:
 	float mStep;
 
 public:
-	void Report(CollidableShape *shape, float distance, const Vector2 &point)
+	void Report(const TargetIndex::Target &target, float distance, const Vector2 &point)
 	{
-		// skip unhittable shapes
-		if (Collidable::IsSensor(shape))
-			return;
-		if (!Collidable::CheckFilter(mGraze.mFilter, Collidable::GetFilter(shape)))
-			return;
-
 		// get the collidable identifier
-		unsigned int targetId = Collidable::GetId(shape);
-
-		// skip non-entity
-		if (targetId == 0)
-			return;
-
-		// skip self
-		if (targetId == mId)
-			return;
-
-		// get center position
-		Vector2 centerPos(Collidable::GetCenter(shape));
-
-		// get direction
-		Vector2 dir(mTransform.Transform(centerPos));
+		// (the index already skipped sensors, filtered shapes, and self)
+		unsigned int targetId = target.mId;
 
 		// apply value falloff
 		float interp;
@@ -328,6 +310,9 @@ void Graze::Update(float aStep)
 	callback.mStep = aStep;
 
 	// get nearby shapes
-	Collidable::QueryRadius(entity->GetPosition(), graze.mRadiusOuter, graze.mFilter, 
-		Collidable::QueryRadiusDelegate(&callback, &GrazeQueryCallback::Report));
+	// (from the index of every entity shape, since grazed bullets are not targets)
+	TargetIndex::Query query(entity->GetPosition(), graze.mRadiusOuter, graze.mFilter);
+	query.mSet = TargetIndex::ENTITIES;
+	query.mSkipId = mId;
+	TargetIndex::QueryRadius(query, TargetIndex::QueryDelegate(&callback, &GrazeQueryCallback::Report));
 }
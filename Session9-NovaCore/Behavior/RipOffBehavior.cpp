@@ -7,6 +7,7 @@
 #include "Entity.h"
 #include "Link.h"
 #include "Collidable.h"
+#include "TargetIndex.h"
 
 
 /*
@@ -505,24 +506,11 @@ public:
 	{
 	}
 
-	void Report(CollidableShape *shape, float distance, const Vector2 &point)
+	void Report(const TargetIndex::Target &target, float distance, const Vector2 &point)
 	{
-		// skip unhittable shapes
-		if (Collidable::IsSensor(shape))
-			return;
-		if (!Collidable::CheckFilter(mFilter, Collidable::GetFilter(shape)))
-			return;
-
 		// get the collidable identifier
-		unsigned int targetId = Collidable::GetId(shape);
-
-		// skip non-entity
-		if (targetId == 0)
-			return;
-
-		// skip self
-		if (targetId == mId)
-			return;
+		// (the index already skipped sensors, filtered shapes, and self)
+		unsigned int targetId = target.mId;
 
 		// if closer than the current best
 		if (mBestDist > distance)
@@ -540,8 +528,11 @@ unsigned int RipOffBehavior::ClosestEntity(float aRadius, const CollidableFilter
 	ClosestEntityCallback callback(mId, aRadius, aFilter, mEntity->GetTransform());
 
 	// perform query
-	Collidable::QueryRadius(mEntity->GetPosition(), aRadius, aFilter, 
-		Collidable::QueryRadiusDelegate(&callback, &ClosestEntityCallback::Report));
+	// (from the index of every entity shape, since friendlies and enemies need not be targets)
+	TargetIndex::Query query(mEntity->GetPosition(), aRadius, aFilter);
+	query.mSet = TargetIndex::ENTITIES;
+	query.mSkipId = mId;
+	TargetIndex::QueryRadius(query, TargetIndex::QueryDelegate(&callback, &ClosestEntityCallback::Report));
 
 	// return best target
 	return callback.mBestTarget;
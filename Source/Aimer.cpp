@@ -124,6 +124,14 @@ Aimer::Aimer(const AimerTemplate &aTemplate, unsigned int aId)
 {
 	SetAction(Action(this, &Aimer::Control));
 
+	// can run on a worker thread if all its behaviors can
+	// (debug drawing and obstacle probes need the main thread)
+#if !defined(AIMER_OBSTACLE_AVOIDANCE) && !defined(AIMER_DEBUG_DRAW_CONTROLS)
+	bool parallel = true;
+#else
+	bool parallel = false;
+#endif
+
 	for (std::vector<unsigned int>::const_iterator itor = aTemplate.mBehaviors.begin(); itor != aTemplate.mBehaviors.end(); ++itor)
 	{
 		const BehaviorDatabase::Initializer::Activate::Entry &activate = BehaviorDatabase::Initializer::Activate::Get(*itor);
@@ -131,8 +139,11 @@ Aimer::Aimer(const AimerTemplate &aTemplate, unsigned int aId)
 		{
 			Behavior *behavior = activate(mId, this);
 			mScheduler.Run(*behavior);
+			parallel = parallel && behavior->IsParallel();
 		}
 	}
+
+	SetParallel(parallel);
 }
 
 Aimer::~Aimer(void)
@@ -8,6 +8,7 @@
 #include "Renderable.h"
 #include "Variable.h"
 #include "Interpolator.h"
+#include "Snapshot.h"
 
 
 #ifdef USE_POOL_ALLOCATOR
@@ -41,6 +42,20 @@ namespace Database
 		Configure beamconfigure(0xa75279fa /* "beam" */, BeamConfigure);
 	}
 
+	namespace Serializer
+	{
+		static void BeamSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::beam.Get(aId)->Save(aWriter);
+		}
+		static void BeamRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Beam *beam = Database::beam.Get(aId))
+				beam->Restore(aReader);
+		}
+		Snapshot::Serializer::Custom beamserializer(0xa75279fa /* "beam" */, BeamSave, BeamRestore);
+	}
+
 	namespace Initializer
 	{
 		static void BeamActivate(unsigned int aId)
@@ -125,6 +140,24 @@ Beam::~Beam(void)
 {
 }
 
+// save snapshot state
+// (a zero life span still updates once, so expiry gets saved too)
+void Beam::Save(Snapshot::Writer &aWriter) const
+{
+	aWriter.Write(mLife);
+	aWriter.Write(IsActive());
+}
+
+// restore snapshot state
+void Beam::Restore(Snapshot::Reader &aReader)
+{
+	bool active = true;
+	aReader.Read(mLife);
+	aReader.Read(active);
+	if (!active)
+		Deactivate();
+}
+
 void Beam::Update(float aStep)
 {
 	// get beam template properties
@@ -168,7 +201,7 @@ void Beam::Update(float aStep)
 		unsigned int hitId = Collidable::TestSegment(start, end, beam.mFilter, mId, lambda, normal, shape);
 
 		// save local endpoint for the renderer
-		Database::Typed<float> &variables = Database::variable.Open(mId);
+		Database::Variables &variables = Database::variable.Open(mId);
 		variables.Put(0x9ea656c7 /* "beamend" */ + 0, 0.0f);
 		variables.Put(0x9ea656c7 /* "beamend" */ + 1, lambda * curRange);
 		variables.Put(0x9ea656c7 /* "beamend" */ + 2, 0.0f);
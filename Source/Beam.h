@@ -27,6 +27,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element, unsigned int id);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 class Beam :
 	public Updatable
 {
@@ -47,6 +53,10 @@ public:
 
 	// update
 	void Update(float aStep);
+
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
 };
 
 namespace Database
@@ -38,6 +38,12 @@ public:
 	AimBehavior(unsigned int aId, const AimBehaviorTemplate &aTemplate, Controller *aController);
 
 	Status Execute(void);
+
+	// safe on a worker thread
+	virtual bool IsParallel(void) const
+	{
+		return true;
+	}
 };
 
 namespace Database
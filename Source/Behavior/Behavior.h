@@ -22,6 +22,13 @@ public:
 	virtual ~Behavior()
 	{
 	}
+
+	// safe on a worker thread?
+	// (only if execution reads the world and writes nothing but its own controller and records)
+	virtual bool IsParallel(void) const
+	{
+		return false;
+	}
 };
 
 namespace BehaviorDatabase
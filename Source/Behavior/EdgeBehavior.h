@@ -22,6 +22,12 @@ public:
 	EdgeBehavior(unsigned int aId, const EdgeBehaviorTemplate &aTemplate, Controller *aController);
 
 	Status Execute(void);
+
+	// safe on a worker thread
+	virtual bool IsParallel(void) const
+	{
+		return true;
+	}
 };
 
 namespace Database
@@ -21,6 +21,12 @@ public:
 	EvadeBehavior(unsigned int aId, const EvadeBehaviorTemplate &aTemplate, Controller *aController);
 
 	Status Execute(void);
+
+	// safe on a worker thread
+	virtual bool IsParallel(void) const
+	{
+		return true;
+	}
 };
 
 namespace Database
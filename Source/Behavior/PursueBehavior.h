@@ -24,6 +24,12 @@ public:
 	PursueBehavior(unsigned int aId, const PursueBehaviorTemplate &aTemplate, Controller *aController);
 
 	Status Execute(void);
+
+	// safe on a worker thread
+	virtual bool IsParallel(void) const
+	{
+		return true;
+	}
 };
 
 namespace Database
@@ -2,10 +2,9 @@
 
 #include "TargetBehavior.h"
 #include "Collidable.h"
+#include "TargetIndex.h"
 #include "Entity.h"
 #include "Team.h"
-#include "Damagable.h"
-#include "Cancelable.h"
 #include "Aimer.h"
 
 namespace Database
@@ -91,9 +90,7 @@ class TargetQueryCallback
 {
 public:
 	TargetBehaviorTemplate mTarget;
-	unsigned int mId;
-	unsigned int mTeam;
-	Transform2 mTransform;
+	const TargetIndex::Query &mQuery;
 	unsigned int mCurrentTarget;
 
 	float mBestRange;
@@ -101,11 +98,9 @@ public:
 	Vector2 mBestTargetPos;
 
 public:
-	TargetQueryCallback(const TargetBehaviorTemplate &aTarget, unsigned int aId, unsigned int aTeam, Transform2 aTransform, unsigned int aCurrentTarget)
+	TargetQueryCallback(const TargetBehaviorTemplate &aTarget, const TargetIndex::Query &aQuery, unsigned int aCurrentTarget)
 		: mTarget(aTarget)
-		, mId(aId)
-		, mTeam(aTeam)
-		, mTransform(aTransform)
+		, mQuery(aQuery)
 		, mCurrentTarget(aCurrentTarget)
 		, mBestRange(FLT_MAX)
 		, mBestTargetId(0)
@@ -113,69 +108,20 @@ public:
 	{
 	}
 
-	void Report(CollidableShape *shape, float range, const Vector2 &point)
+	void Report(const TargetIndex::Target &target, float range, const Vector2 &point)
 	{
-		// skip unhittable fixtures
-		if (Collidable::IsSensor(shape))
-			return;
-		if (!Collidable::CheckFilter(mTarget.mFilter, Collidable::GetFilter(shape)))
-			return;
-
-		// get the collidable identifier
-		unsigned int targetId = Collidable::GetId(shape);
-
-		// skip non-entity
-		if (targetId == 0)
-			return;
-
-		// skip self
-		if (targetId == mId)
-			return;
-
-		// get team affiliation
-		unsigned int targetTeam = Database::team.Get(targetId);
-
-		// skip neutral
-		if (targetTeam == 0)
-			return;
-
-		// skip teammate
-		if (targetTeam == mTeam)
-			return;
-
-		// skip indestructible
-		if (!Database::damagable.Find(targetId) && !Database::cancelable.Find(targetId))
-			return;
+		// get the target identifier
+		// (the index already skipped sensors, filtered shapes, self, neutrals, teammates, and targets outside the cone)
+		unsigned int targetId = target.mId;
 
 		// get center position
-		Vector2 centerPos(Collidable::GetCenter(shape));
-
-		// get local direction
-		Vector2 localDir(mTransform.Untransform(centerPos));
+		const Vector2 &centerPos = target.mCenter;
 
-		// if using a cone angle or angle scale
-		if (mTarget.mAngle < float(M_PI)*2.0f || mTarget.mAlign != 0.0f)
+		// if using angle scale...
+		if (mTarget.mAlign != 0.0f)
 		{
-			// get angle to target
-			float aimAngle = -atan2f(localDir.x, localDir.y);
-
-			// get local angle
-			float localAngle = aimAngle - mTarget.mDirection;
-			if (localAngle > float(M_PI))
-				localAngle -= float(M_PI)*2.0f;
-			else if (localAngle < -float(M_PI))
-				localAngle += float(M_PI)*2.0f;
-
-			// skip if outside angle
-			if (fabsf(localAngle) > mTarget.mAngle)
-				return;
-
-			// if using angle scale...
-			if (mTarget.mAlign != 0.0f)
-			{
-				// apply angle scale
-				range *= 1.0f + fabsf(localAngle) * mTarget.mAlign;
-			}
+			// apply angle scale
+			range *= 1.0f + fabsf(TargetIndex::GetConeAngle(mQuery, centerPos)) * mTarget.mAlign;
 		}
 
 		// if the current target...
@@ -225,10 +171,15 @@ Status TargetBehavior::Execute(void)
 	unsigned int &mTarget = data.mTarget;
 	Vector2 &mOffset = data.mOffset;
 
-	// query nearby fixtures
-	TargetQueryCallback callback(target, mId, aTeam, transform, data.mTarget);
-	Collidable::QueryRadius(entity->GetPosition(), target.mRange, target.mFilter,
-		Collidable::QueryRadiusDelegate(&callback, &TargetQueryCallback::Report));
+	// query nearby targets
+	// (from the target index, which is safe on a worker thread)
+	TargetIndex::Query query(entity->GetPosition(), target.mRange, target.mFilter);
+	query.mSkipId = mId;
+	query.mSkipTeam = aTeam;
+	query.mSkipNeutral = true;
+	query.SetCone(transform, target.mDirection, target.mAngle);
+	TargetQueryCallback callback(target, query, data.mTarget);
+	TargetIndex::QueryRadius(query, TargetIndex::QueryDelegate(&callback, &TargetQueryCallback::Report));
 
 	// use the new target
 	mTarget = callback.mBestTargetId;
@@ -39,6 +39,12 @@ public:
 	TargetBehavior(unsigned int aId, const TargetBehaviorTemplate &aTemplate, Controller *aController);
 
 	Status Execute(void);
+
+	// safe on a worker thread
+	virtual bool IsParallel(void) const
+	{
+		return true;
+	}
 };
 
 namespace Database
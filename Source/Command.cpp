@@ -5,6 +5,9 @@
 #include "World.h"
 #include "Sound.h"
 #include "GameState.h"
+#include "PerfTimer.h"
+#include "Profiler.h"
+#include "Snapshot.h"
 
 
 // console
@@ -345,6 +348,43 @@ int CommandPlayback(const char * const aParam[], int aCount)
 }
 Command commandplayback(0xcf8a43ec /* "playback" */, CommandPlayback);
 
+int CommandSeek(const char * const aParam[], int aCount)
+{
+	if (aCount >= 1)
+	{
+		// seek playback to the turn
+		const unsigned int turn = strtoul(aParam[0], NULL, 10);
+		if (!SeekTurn(turn))
+			console->Print("seek: cannot reach turn %u (at turn %u)\n", turn, sim_turn);
+		return 1;
+	}
+	else
+	{
+		console->Print("seek: turn %u\n", sim_turn);
+		return 0;
+	}
+}
+Command commandseek(0x5745c7b1 /* "seek" */, CommandSeek);
+
+int CommandDigest(const char * const aParam[], int aCount)
+{
+	return ProcessCommandBool(JOURNAL_DIGEST, aParam, aCount, NULL, "digest: %d\n");
+}
+Command commanddigest(0xf92455dd /* "digest" */, CommandDigest);
+
+int CommandHeadless(const char * const aParam[], int aCount)
+{
+	// run headless, optionally for a fixed number of turns
+	headless = true;
+	if (aCount >= 1)
+	{
+		HEADLESS_TURNS = atoi(aParam[0]);
+		return 1;
+	}
+	return 0;
+}
+Command commandheadless(0xe68ca756 /* "headless" */, CommandHeadless);
+
 int CommandSimRate(const char * const aParam[], int aCount)
 {
 	return ProcessCommandInt(SIMULATION_RATE, aParam, aCount, NULL, "simrate: %d\n");
@@ -363,6 +403,17 @@ int CommandFixedStep(const char * const aParam[], int aCount)
 }
 Command commandfixedstep(0xe065cb63 /* "fixedstep" */, CommandFixedStep);
 
+void ClampControlThreadsAction()
+{
+	if (CONTROL_THREADS < 0)
+		CONTROL_THREADS = 0;
+}
+int CommandControlThreads(const char * const aParam[], int aCount)
+{
+	return ProcessCommandInt(CONTROL_THREADS, aParam, aCount, ClampControlThreadsAction, "controlthreads: %d\n");
+}
+Command commandcontrolthreads(0xfcb92a1b /* "controlthreads" */, CommandControlThreads);
+
 int CommandMotionBlur(const char * const aParam[], int aCount)
 {
 	return ProcessCommandInt(MOTIONBLUR_STEPS, aParam, aCount, ClampMotionBlurAction, "motionblur: %d\n");
@@ -423,6 +474,29 @@ int CommandProfilePrint(const char * const aParam[], int aCount)
 }
 Command commandprofileprint(0x85e872f9 /* "profileprint" */, CommandProfilePrint);
 
+int CommandProfileTrace(const char * const aParam[], int aCount)
+{
+	if (aCount >= 1)
+	{
+		// capture the next turns to a trace file
+		const int turns = atoi(aParam[0]);
+		const char *filename = aCount >= 2 ? aParam[1] : "profile.json";
+		Profiler::Capture(turns, filename);
+		return aCount >= 2 ? 2 : 1;
+	}
+	else if (console)
+	{
+		console->Print("profiletrace <turns> [file]\n");
+		return 0;
+	}
+	else
+	{
+		DebugPrint("profiletrace <turns> [file]\n");
+		return 0;
+	}
+}
+Command commandprofiletrace(0xe822d0d3 /* "profiletrace" */, CommandProfileTrace);
+
 int CommandFrameRateScreen(const char * const aParam[], int aCount)
 {
 	return ProcessCommandBool(FRAMERATE_OUTPUTSCREEN, aParam, aCount, NULL, "frameratescreen: %d\n");
@@ -435,6 +509,70 @@ int CommandFrameRatePrint(const char * const aParam[], int aCount)
 }
 Command commandframerateprint(0x55cfbc33 /* "framerateprint" */, CommandFrameRatePrint);
 
+void DatabaseScreenAction()
+{
+	// the overlay shows lookup statistics, so start collecting them
+	if (DATABASE_OUTPUTSCREEN)
+		Database::collectstatistics = true;
+}
+int CommandDatabaseScreen(const char * const aParam[], int aCount)
+{
+	return ProcessCommandBool(DATABASE_OUTPUTSCREEN, aParam, aCount, DatabaseScreenAction, "databasescreen: %d\n");
+}
+Command commanddatabasescreen(0x0293af0c /* "databasescreen" */, CommandDatabaseScreen);
+
+int CommandDatabaseLookups(const char * const aParam[], int aCount)
+{
+	return ProcessCommandBool(Database::collectstatistics, aParam, aCount, NULL, "databaselookups: %d\n");
+}
+Command commanddatabaselookups(0x29aa11e7 /* "databaselookups" */, CommandDatabaseLookups);
+
+int CommandRenderScreen(const char * const aParam[], int aCount)
+{
+	return ProcessCommandBool(RENDER_OUTPUTSCREEN, aParam, aCount, NULL, "renderscreen: %d\n");
+}
+Command commandrenderscreen(0x5bb43529 /* "renderscreen" */, CommandRenderScreen);
+
+int CommandDatabaseStats(const char * const aParam[], int aCount)
+{
+	console->Print("database   count/limit stride grows lookups probeavg probemax bytes\n");
+
+	// for each registered database...
+	for (Database::Typed<Database::Untyped *>::Iterator itor(&Database::GetDatabases()); itor.IsValid(); ++itor)
+	{
+		const Database::Untyped *database = itor.GetValue();
+		console->Print("0x%08x %u/%u %u %u %u %.2f %u %u\n",
+			database->GetId(),
+			unsigned(database->GetCount()), unsigned(database->GetLimit()), unsigned(database->GetStride()),
+			unsigned(database->GetGrowCount()), unsigned(database->GetLookupCount()),
+			database->GetProbeAverage(), unsigned(database->GetProbeMax()),
+			unsigned(database->GetBytes()));
+	}
+	return 0;
+}
+Command commanddatabasestats(0xc2d4763b /* "databasestats" */, CommandDatabaseStats);
+
+int CommandDatabaseCSV(const char * const aParam[], int aCount)
+{
+	if (aCount >= 1)
+	{
+		// start writing per-turn statistics
+		if (Database::Statistics::OpenCSV(aParam[0]))
+			console->Print("databasecsv: %s\n", aParam[0]);
+		else
+			console->Print("error opening \"%s\"\n", aParam[0]);
+		return 1;
+	}
+	else
+	{
+		// stop writing
+		Database::Statistics::CloseCSV();
+		console->Print("databasecsv: off\n");
+		return 0;
+	}
+}
+Command commanddatabasecsv(0xaf9503c0 /* "databasecsv" */, CommandDatabaseCSV);
+
 int CommandDebugDraw(const char * const aParam[], int aCount)
 {
 	return ProcessCommandBool(DEBUG_DRAW, aParam, aCount, NULL, "debugdraw: %d\n");
@@ -575,6 +713,290 @@ int CommandComponents(const char * const aParam[], int aCount)
 }
 Command commandcomponents(0x1bf51169 /* "components" */, CommandComponents);
 
+// time spawning and despawning instances of a template
+// (reports to the console, or to the debug output when there is no console)
+void BenchmarkSpawn(unsigned int aTemplateId, int aCount)
+{
+	// for each lifecycle mode...
+	static const char * const passname[3] = { "membership", "full scan", "batch" };
+	std::vector<unsigned int> instances(aCount);
+	std::vector<Transform2> transforms(aCount, Transform2::Identity());
+	const bool usemembership = Database::usemembership;
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		Database::usemembership = (pass != 1);
+
+		// spawn instances
+		PerfTimer spawn_timer;
+		spawn_timer.Clear();
+		spawn_timer.Start();
+		if (pass == 2)
+		{
+			Database::InstantiateBatch(aTemplateId, 0, 0, aCount, &transforms[0], NULL, &instances[0]);
+		}
+		else
+		{
+			for (int i = 0; i < aCount; ++i)
+				instances[i] = Database::Instantiate(aTemplateId, 0, 0, 0, Vector2(0, 0));
+		}
+		Database::Update();
+		spawn_timer.Stop();
+
+		// despawn instances
+		PerfTimer despawn_timer;
+		despawn_timer.Clear();
+		despawn_timer.Start();
+		for (int i = 0; i < aCount; ++i)
+			Database::Delete(instances[i]);
+		Database::Update();
+		despawn_timer.Stop();
+
+		// report throughput
+		int spawn = spawn_timer.Microseconds();
+		int despawn = despawn_timer.Microseconds();
+		char buf[256];
+		sprintf(buf, "%s: spawn=%dus (%.2fus each) despawn=%dus (%.2fus each)\n",
+			passname[pass],
+			spawn, float(spawn) / aCount, despawn, float(despawn) / aCount);
+		if (console)
+			console->Print("%s", buf);
+		else
+			DebugPrint("%s", buf);
+	}
+	Database::usemembership = usemembership;
+}
+
+int CommandBenchmarkSpawn(const char * const aParam[], int aCount)
+{
+	if (aCount >= 1)
+	{
+		// get the template identifier
+		unsigned int id;
+		if (!TIXML_SSCANF(aParam[0], "0x%x", &id))
+			id = Hash(aParam[0]);
+
+		// get the spawn count
+		int count = 1000;
+		if (aCount >= 2)
+			count = std::max(1, atoi(aParam[1]));
+
+		// from the command line, run headless and benchmark once the level loads
+		if (!console)
+		{
+			headless = true;
+			HEADLESS_BENCHMARK_SPAWN = id;
+			HEADLESS_BENCHMARK_COUNT = count;
+		}
+		else
+		{
+			BenchmarkSpawn(id, count);
+		}
+		return aCount >= 2 ? 2 : 1;
+	}
+	else
+	{
+		return 0;
+	}
+}
+Command commandbenchmarkspawn(0x85f3f8c3 /* "benchmarkspawn" */, CommandBenchmarkSpawn);
+
+// linear-probe reference map
+// (the database hash map before grouped probing, kept for comparison;
+// values are stored inline, so puts skip the record pool and membership work)
+class BenchmarkLinearMap
+{
+	static const size_t EMPTY = ~0U;
+	size_t mBits;
+	size_t mMask;
+	size_t mCount;
+	std::vector<size_t> mMap;
+	std::vector<unsigned int> mKey;
+	std::vector<int> mData;
+
+	size_t Index(unsigned int aKey) const
+	{
+		return ((aKey >> (mBits + 1)) ^ aKey) & mMask;
+	}
+
+	size_t FindIndex(unsigned int aKey) const
+	{
+		size_t index = Index(aKey);
+		while (mMap[index] != EMPTY && mKey[mMap[index]] != aKey)
+			index = (index + 1) & mMask;
+		return index;
+	}
+
+public:
+	BenchmarkLinearMap(size_t aBits)
+		: mBits(aBits), mMask((2 << aBits) - 1), mCount(0), mMap(2 << aBits, EMPTY), mKey(1 << aBits), mData(1 << aBits)
+	{
+	}
+
+	const int *Find(unsigned int aKey) const
+	{
+		const size_t slot = mMap[FindIndex(aKey)];
+		return slot != EMPTY ? &mData[slot] : NULL;
+	}
+
+	void Put(unsigned int aKey, int aValue)
+	{
+		const size_t index = FindIndex(aKey);
+		if (mMap[index] == EMPTY)
+		{
+			mMap[index] = mCount;
+			mKey[mCount] = aKey;
+			++mCount;
+		}
+		mData[mMap[index]] = aValue;
+	}
+
+	void Delete(unsigned int aKey)
+	{
+		size_t index = FindIndex(aKey);
+		const size_t slot = mMap[index];
+		if (slot == EMPTY)
+			return;
+
+		// move the last record into the vacant slot
+		if (slot < --mCount)
+		{
+			mKey[slot] = mKey[mCount];
+			mData[slot] = mData[mCount];
+			mMap[FindIndex(mKey[slot])] = slot;
+		}
+
+		// shift the rest of the cluster back
+		for (size_t next = (index + 1) & mMask; mMap[next] != EMPTY; next = (next + 1) & mMask)
+		{
+			const size_t home = Index(mKey[mMap[next]]);
+			if (((next - home) & mMask) >= ((next - index) & mMask))
+			{
+				mMap[index] = mMap[next];
+				index = next;
+			}
+		}
+		mMap[index] = EMPTY;
+	}
+};
+
+// time put, find hit, find miss, and delete on a database-like map
+template <typename T> static void BenchmarkMap(T &aMap, const std::vector<unsigned int> &aKeys, const std::vector<unsigned int> &aMisses, int aMicroseconds[4])
+{
+	PerfTimer timer;
+	int sum = 0;
+
+	timer.Clear();
+	timer.Start();
+	for (size_t i = 0; i < aKeys.size(); ++i)
+		aMap.Put(aKeys[i], int(i));
+	timer.Stop();
+	aMicroseconds[0] = timer.Microseconds();
+
+	timer.Clear();
+	timer.Start();
+	for (size_t i = 0; i < aKeys.size(); ++i)
+		sum += *aMap.Find(aKeys[i]);
+	timer.Stop();
+	aMicroseconds[1] = timer.Microseconds();
+
+	timer.Clear();
+	timer.Start();
+	for (size_t i = 0; i < aMisses.size(); ++i)
+		sum += aMap.Find(aMisses[i]) != NULL;
+	timer.Stop();
+	aMicroseconds[2] = timer.Microseconds();
+
+	timer.Clear();
+	timer.Start();
+	for (size_t i = 0; i < aKeys.size(); ++i)
+		aMap.Delete(aKeys[i]);
+	timer.Stop();
+	aMicroseconds[3] = timer.Microseconds();
+
+	// keep the lookups from being optimized away
+	static volatile int sink;
+	sink = sum;
+}
+
+int CommandBenchmarkDatabase(const char * const aParam[], int aCount)
+{
+	// for each record count...
+	static const int sizes[3] = { 1000, 10000, 100000 };
+	for (int size = 0; size < 3; ++size)
+	{
+		// generate hashed keys, as identifiers are
+		const int count = sizes[size];
+		std::vector<unsigned int> keys(count), misses(count);
+		for (int i = 0; i < count; ++i)
+		{
+			keys[i] = Hash(&i, sizeof(i));
+			misses[i] = Hash(&i, sizeof(i), 0x5eed5eed);
+		}
+
+		// time the grouped database map and the linear-probe reference
+		// (both sized up front so growth does not skew the put times)
+		int grouped[4], linear[4];
+		{
+			Database::Typed<int> database(0);
+			database.Reserve(keys.size());
+			BenchmarkMap(database, keys, misses, grouped);
+		}
+		{
+			size_t bits = 8;
+			while ((1U << bits) < keys.size())
+				++bits;
+			BenchmarkLinearMap reference(bits);
+			BenchmarkMap(reference, keys, misses, linear);
+		}
+
+		// report throughput
+		static const char * const opname[4] = { "put", "find", "miss", "delete" };
+		console->Print("%d records:\n", count);
+		for (int op = 0; op < 4; ++op)
+		{
+			console->Print("  %-6s grouped=%dus (%.1fns each) linear=%dus (%.1fns each)\n",
+				opname[op],
+				grouped[op], 1000.0f * grouped[op] / count, linear[op], 1000.0f * linear[op] / count);
+		}
+	}
+	return 0;
+}
+Command commandbenchmarkdatabase(0x60a6e981 /* "benchmarkdatabase" */, CommandBenchmarkDatabase);
+
+int CommandSnapshotSave(const char * const aParam[], int aCount)
+{
+	if (aCount >= 1)
+	{
+		if (Snapshot::SaveFile(aParam[0]))
+			console->Print("snapshot saved to \"%s\"\n", aParam[0]);
+		else
+			console->Print("error saving snapshot to \"%s\"\n", aParam[0]);
+		return 1;
+	}
+	else
+	{
+		return 0;
+	}
+}
+Command commandsnapshotsave(0x0450dff0 /* "snapshotsave" */, CommandSnapshotSave);
+
+int CommandSnapshotLoad(const char * const aParam[], int aCount)
+{
+	if (aCount >= 1)
+	{
+		if (Snapshot::LoadFile(aParam[0]))
+			console->Print("snapshot loaded from \"%s\"\n", aParam[0]);
+		else
+			console->Print("error loading snapshot from \"%s\"\n", aParam[0]);
+		return 1;
+	}
+	else
+	{
+		return 0;
+	}
+}
+Command commandsnapshotload(0x8399efd1 /* "snapshotload" */, CommandSnapshotLoad);
+
 int CommandSound(const char * const aParam[], int aCount)
 {
 	if (aCount >= 2)
@@ -1,6 +1,7 @@
 #include "StdAfx.h"
 
 #include "Updatable.h"
+#include "Profiler.h"
 //#include "ExpressionSchema.h"
 #include "ExpressionConfigure.h"
 #include "ExpressionAction.h"
@@ -102,6 +103,8 @@ Condition::Condition(unsigned int aId, unsigned int aSubId)
 
 void Condition::Update(float aStep)
 {
+	PROFILE_ZONE("Condition::Update");
+
 	const ConditionTemplate &conditiontemplate = Database::conditiontemplate.Get(mId).Get(mSubId);
 	
 	if (!conditiontemplate.mCondition.empty())
@@ -4,11 +4,25 @@
 #include "Link.h"
 #include "Command.h"
 #include "Console.h"
+#include "Snapshot.h"
+#include "Profiler.h"
 
 // Chipmunk includes
 #pragma message( "chipmunk" )
 #include "chipmunk/chipmunk_private.h"
 #include "chipmunk/chipmunk.h"
+#ifdef COLLIDABLE_HASTY_SPACE
+#include "chipmunk/cpHastySpace.h"
+#endif
+
+// console
+extern Console *console;
+
+namespace Collidable
+{
+	// physics world revision
+	extern unsigned int revision;
+}
 
 namespace Database
 {
@@ -18,10 +32,53 @@ namespace Database
 	Typed<Typed<CollidablePolygonDef> > collidablepolygons(0xab54c159 /* "collidablepolygons" */);
 	Typed<Typed<CollidableEdgeDef> > collidableedges(0xae12a01c /* "collidableedges" */);
 	Typed<Typed<CollidableChainDef> > collidablechains(0xd2bae418 /* "collidablechains" */);
-	Typed<cpBody *> collidablebody(0x6ccc2b62 /* "collidablebody" */);
+	Dense<cpBody *> collidablebody(0x6ccc2b62 /* "collidablebody" */);
 	Typed<Collidable::ContactSignal> collidablecontactadd(0x7cf2c45d /* "collidablecontactadd" */);
 	Typed<Collidable::SeparateSignal> collidablecontactremove(0x95ed5aba /* "collidablecontactremove" */);
 
+	namespace Serializer
+	{
+		static void CollidableBodySave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			cpBody *body = Database::collidablebody.Get(aId);
+			aWriter.Write(cpBodyGetPosition(body));
+			aWriter.Write(cpBodyGetAngle(body));
+			aWriter.Write(cpBodyGetVelocity(body));
+			aWriter.Write(cpBodyGetAngularVelocity(body));
+			aWriter.Write(cpBodyGetForce(body));
+			aWriter.Write(cpBodyGetTorque(body));
+		}
+		static void CollidableBodyRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			// static bodies stay where activation put them
+			cpBody *body = Database::collidablebody.Get(aId);
+			if (!body || cpBodyGetType(body) == CP_BODY_TYPE_STATIC)
+				return;
+
+			cpVect pos, vel, force;
+			cpFloat angle, omega, torque;
+			aReader.Read(pos);
+			aReader.Read(angle);
+			aReader.Read(vel);
+			aReader.Read(omega);
+			aReader.Read(force);
+			aReader.Read(torque);
+
+			cpBodySetPosition(body, pos);
+			cpBodySetAngle(body, angle);
+			cpBodySetVelocity(body, vel);
+			cpBodySetAngularVelocity(body, omega);
+			cpBodySetForce(body, force);
+			cpBodySetTorque(body, torque);
+
+			// update the space's spatial index for the moved body
+			if (cpSpace *space = cpBodyGetSpace(body))
+				cpSpaceReindexShapesForBody(space, body);
+			++Collidable::revision;
+		}
+		Snapshot::Serializer::Custom collidablebodyserializer(0x6ccc2b62 /* "collidablebody" */, CollidableBodySave, CollidableBodyRestore);
+	}
+
 	namespace Loader
 	{
 		struct FilterDefault
@@ -528,11 +585,53 @@ namespace Collidable
 	cpSpace* world;
 	AlignedBox2 boundary;
 	unsigned int poststepkey;
+	CollidableSolverDef solver;
+	unsigned int revision = 1;
+
+	// contact events from the physics step
+	std::vector<ContactEvent> contacts;
+
+	// next contact event to signal
+	// (all ones while not signaling)
+	size_t contactsignal = ~size_t(0);
+}
+
+// body added signal
+Collidable::BodySignal &Collidable::GetBodyAdded(void)
+{
+	static BodySignal signal;
+	return signal;
+}
+
+// body removed signal
+Collidable::BodySignal &Collidable::GetBodyRemoved(void)
+{
+	static BodySignal signal;
+	return signal;
+}
+
+// keep the id of the first shape of a body
+static void GetFirstShapeId(cpBody *body, cpShape *shape, void *data)
+{
+	Database::Key &id = *static_cast<Database::Key *>(data);
+	if (!id)
+		id = reinterpret_cast<Database::Key>(cpShapeGetUserData(shape));
+}
+
+// get the owner id of a body
+// (body user data holds the entity, which states share with their owner,
+// so this comes from the shapes; a dynamic body always has a shape to give it mass;
+// zero for a body without shapes)
+static Database::Key GetBodyId(cpBody *body)
+{
+	Database::Key id = 0;
+	cpBodyEachShape(body, GetFirstShapeId, &id);
+	return id;
 }
 
 static void BodyUpdateVelocity(cpBody *body, cpVect gravity, cpFloat damping, cpFloat dt)
 {
-	Database::Key id = reinterpret_cast<Database::Key>(cpBodyGetUserData(body));
+	Database::Key id = GetBodyId(body);
 	const CollidableTemplate &collidable = Database::collidabletemplate.Get(id);
 	const CollidableBodyDef &def = collidable.mBodyDef;
 
@@ -553,15 +652,18 @@ static cpBool BeginContact(cpArbiter *arb, cpSpace *space, cpDataPointer data)
 	if (!retA || !retB)
 		return false;
 
-	// signal contact add
-	Database::Key id1 = reinterpret_cast<Database::Key>(cpShapeGetUserData(a));
-	Database::Key id2 = reinterpret_cast<Database::Key>(cpShapeGetUserData(b));
+	// record contact add
+	// (signaled after the step so gameplay code never runs inside the solver)
 	cpVect c = cpArbiterGetPointA(arb, 0);
 	cpVect n = cpArbiterGetNormal(arb);
-	const Vector2 contact(float(c.x), float(c.y));
-	const Vector2 normal(float(n.x), float(n.y));
-	Database::collidablecontactadd.Get(id1)(id1, id2, 0.0f, contact, normal);
-	Database::collidablecontactadd.Get(id2)(id2, id1, 0.0f, contact, normal);
+	Collidable::ContactEvent event;
+	event.mId1 = reinterpret_cast<Database::Key>(cpShapeGetUserData(a));
+	event.mId2 = reinterpret_cast<Database::Key>(cpShapeGetUserData(b));
+	event.mTime = 0.0f;
+	event.mContact = Vector2(float(c.x), float(c.y));
+	event.mNormal = Vector2(float(n.x), float(n.y));
+	event.mAdd = true;
+	Collidable::contacts.push_back(event);
 	return true;
 }
 
@@ -569,13 +671,60 @@ static void EndContact(cpArbiter *arb, cpSpace *space, cpDataPointer data)
 {
 	CP_ARBITER_GET_SHAPES(arb, a, b);
 
-	// signal contact end
+	// record contact end during the step; signal it right away otherwise
+	// (removing a shape outside the step separates its contacts immediately)
 	Database::Key id1 = reinterpret_cast<Database::Key>(cpShapeGetUserData(a));
 	Database::Key id2 = reinterpret_cast<Database::Key>(cpShapeGetUserData(b));
-	Database::collidablecontactremove.Get(id1)(id1, id2, 0.0f);
-	Database::collidablecontactremove.Get(id2)(id2, id1, 0.0f);
+	if (Collidable::contactsignal != ~size_t(0))
+	{
+		// a contact handler removed a shape while signaling
+		// if the pair's add has not been signaled yet, drop both
+		// (listeners never see a remove before its add)
+		std::vector<Collidable::ContactEvent> &contacts = Collidable::contacts;
+		bool dropped = false;
+		for (size_t i = Collidable::contactsignal; i < contacts.size(); ++i)
+		{
+			Collidable::ContactEvent &event = contacts[i];
+			if (event.mAdd && ((event.mId1 == id1 && event.mId2 == id2) || (event.mId1 == id2 && event.mId2 == id1)))
+			{
+				event.mId1 = event.mId2 = 0;
+				dropped = true;
+				break;
+			}
+		}
+
+		// otherwise signal the remove after the current events
+		if (!dropped)
+		{
+			Collidable::ContactEvent event;
+			event.mId1 = id1;
+			event.mId2 = id2;
+			event.mTime = 0.0f;
+			event.mContact = Vector2(0.0f, 0.0f);
+			event.mNormal = Vector2(0.0f, 0.0f);
+			event.mAdd = false;
+			contacts.push_back(event);
+		}
+	}
+	else if (cpSpaceIsLocked(space))
+	{
+		Collidable::ContactEvent event;
+		event.mId1 = id1;
+		event.mId2 = id2;
+		event.mTime = 0.0f;
+		event.mContact = Vector2(0.0f, 0.0f);
+		event.mNormal = Vector2(0.0f, 0.0f);
+		event.mAdd = false;
+		Collidable::contacts.push_back(event);
+	}
+	else
+	{
+		Database::collidablecontactremove.Get(id1)(id1, id2, 0.0f);
+		Database::collidablecontactremove.Get(id2)(id2, id1, 0.0f);
+	}
 
 	// arbiter end contact
+	// (always, to balance the begin callbacks that already ran)
 	cpArbiterCallWildcardSeparateA(arb, space);
 	cpArbiterCallWildcardSeparateB(arb, space);
 }
@@ -855,9 +1004,6 @@ static void DebugDrawShapes(cpSpace *space)
 	cpSpaceDebugDraw(space, &drawOptions);
 }
 
-// console
-extern Console *console;
-
 int CommandDrawCollidable(const char * const aParam[], int aCount)
 {
 #if 1
@@ -918,6 +1064,219 @@ const AlignedBox2 &Collidable::GetBoundary(void)
 	return boundary;
 }
 
+// copy a shape into a spatial index
+static void CopyShapeToIndex(void *obj, void *data)
+{
+	cpShape *shape = static_cast<cpShape *>(obj);
+	cpSpatialIndexInsert(static_cast<cpSpatialIndex *>(data), shape, shape->hashid);
+}
+
+// get the velocity of a shape's body
+// (the same as the velocity function cpSpaceInit gives the dynamic tree)
+static cpVect ShapeVelocityFunc(cpShape *shape)
+{
+	return shape->body->v;
+}
+
+// switch the physics world to bounding box tree indices
+// (the counterpart of cpSpaceUseSpatialHash, which Chipmunk does not provide;
+// set up the way cpSpaceInit does, so dynamic leaves get extended by velocity)
+static void UseBBTree(cpSpace *space)
+{
+	cpSpatialIndex *staticShapes = cpBBTreeNew((cpSpatialIndexBBFunc)cpShapeGetBB, NULL);
+	cpSpatialIndex *dynamicShapes = cpBBTreeNew((cpSpatialIndexBBFunc)cpShapeGetBB, staticShapes);
+	cpBBTreeSetVelocityFunc(dynamicShapes, (cpBBTreeVelocityFunc)ShapeVelocityFunc);
+	cpSpatialIndexEach(space->staticShapes, CopyShapeToIndex, staticShapes);
+	cpSpatialIndexEach(space->dynamicShapes, CopyShapeToIndex, dynamicShapes);
+	cpSpatialIndexFree(space->staticShapes);
+	cpSpatialIndexFree(space->dynamicShapes);
+	space->staticShapes = staticShapes;
+	space->dynamicShapes = dynamicShapes;
+}
+
+// apply solver settings to a physics world
+// (rebuilds the shape indices only if the index settings changed)
+static void ApplySolver(cpSpace *aSpace, const CollidableSolverDef &aSolver, const CollidableSolverDef &aPrev)
+{
+	cpSpaceSetIterations(aSpace, std::max(aSolver.mIterations, 1));
+	cpSpaceSetCollisionSlop(aSpace, aSolver.mSlop);
+#ifdef COLLIDABLE_HASTY_SPACE
+	cpHastySpaceSetThreads(aSpace, std::max(aSolver.mThreads, 0));
+#endif
+
+	if (aSolver.mSpatialHash != aPrev.mSpatialHash ||
+		(aSolver.mSpatialHash && (aSolver.mCellSize != aPrev.mCellSize || aSolver.mCellCount != aPrev.mCellCount)))
+	{
+		if (aSolver.mSpatialHash)
+			cpSpaceUseSpatialHash(aSpace, std::max(aSolver.mCellSize, 1.0f), std::max(aSolver.mCellCount, 1));
+		else
+			UseBBTree(aSpace);
+	}
+}
+
+const std::vector<Collidable::ContactEvent> &Collidable::GetContacts(void)
+{
+	return contacts;
+}
+
+// order contact events by identifier pair
+static bool CompareContacts(const Collidable::ContactEvent &aEvent1, const Collidable::ContactEvent &aEvent2)
+{
+	if (aEvent1.mId1 != aEvent2.mId1)
+		return aEvent1.mId1 < aEvent2.mId1;
+	return aEvent1.mId2 < aEvent2.mId2;
+}
+
+// signal the contact events from the physics step
+// (sorted so the order does not depend on the spatial index or solver;
+// a stable sort keeps each pair's add and remove in step order;
+// separations caused by the handlers themselves get queued behind the events)
+static void SignalContacts(void)
+{
+	std::vector<Collidable::ContactEvent> &contacts = Collidable::contacts;
+	std::stable_sort(contacts.begin(), contacts.end(), CompareContacts);
+	for (size_t i = 0; i < contacts.size(); ++i)
+	{
+		// copy the event
+		// (handlers may queue more)
+		const Collidable::ContactEvent event = contacts[i];
+		Collidable::contactsignal = i + 1;
+
+		// skip adds dropped because a handler removed the shapes
+		if (event.mId1 == 0 && event.mId2 == 0)
+			continue;
+
+		if (event.mAdd)
+		{
+			Database::collidablecontactadd.Get(event.mId1)(event.mId1, event.mId2, event.mTime, event.mContact, event.mNormal);
+			Database::collidablecontactadd.Get(event.mId2)(event.mId2, event.mId1, event.mTime, event.mContact, event.mNormal);
+		}
+		else
+		{
+			Database::collidablecontactremove.Get(event.mId1)(event.mId1, event.mId2, event.mTime);
+			Database::collidablecontactremove.Get(event.mId2)(event.mId2, event.mId1, event.mTime);
+		}
+	}
+	Collidable::contactsignal = ~size_t(0);
+}
+
+unsigned int Collidable::GetRevision(void)
+{
+	return revision;
+}
+
+const CollidableSolverDef &Collidable::GetSolver(void)
+{
+	return solver;
+}
+
+void Collidable::SetSolver(const CollidableSolverDef &aSolver)
+{
+	const CollidableSolverDef prev = solver;
+	solver = aSolver;
+#ifndef COLLIDABLE_HASTY_SPACE
+	solver.mThreaded = false;
+#endif
+	if (world)
+		ApplySolver(world, solver, prev);
+}
+
+int CommandPhysicsSolver(const char * const aParam[], int aCount)
+{
+	CollidableSolverDef solver(Collidable::GetSolver());
+	if (aCount >= 1)
+	{
+		switch (Hash(aParam[0]))
+		{
+		case 0x3553e285 /* "space" */:
+			solver.mThreaded = false;
+			break;
+
+		case 0x30f97f24 /* "hasty" */:
+			solver.mThreaded = true;
+			break;
+
+		default:
+			console->Print("physicssolver: unknown solver \"%s\"\n", aParam[0]);
+			return 1;
+		}
+		Collidable::SetSolver(solver);
+		return 1;
+	}
+	else
+	{
+		console->Print("physicssolver: %s\n", solver.mThreaded ? "hasty" : "space");
+		return 0;
+	}
+}
+Command commandphysicssolver(0xe2ce921d /* "physicssolver" */, CommandPhysicsSolver);
+
+int CommandPhysicsThreads(const char * const aParam[], int aCount)
+{
+	CollidableSolverDef solver(Collidable::GetSolver());
+	const int result = ProcessCommandInt(solver.mThreads, aParam, aCount, NULL, "physicsthreads: %d\n");
+	Collidable::SetSolver(solver);
+	return result;
+}
+Command commandphysicsthreads(0xb8fcc4ff /* "physicsthreads" */, CommandPhysicsThreads);
+
+int CommandPhysicsIterations(const char * const aParam[], int aCount)
+{
+	CollidableSolverDef solver(Collidable::GetSolver());
+	const int result = ProcessCommandInt(solver.mIterations, aParam, aCount, NULL, "physicsiterations: %d\n");
+	Collidable::SetSolver(solver);
+	return result;
+}
+Command commandphysicsiterations(0x564858b6 /* "physicsiterations" */, CommandPhysicsIterations);
+
+int CommandPhysicsIndex(const char * const aParam[], int aCount)
+{
+	CollidableSolverDef solver(Collidable::GetSolver());
+	if (aCount >= 1)
+	{
+		switch (Hash(aParam[0]))
+		{
+		case 0x3f754395 /* "bbtree" */:
+			solver.mSpatialHash = false;
+			Collidable::SetSolver(solver);
+			return 1;
+
+		case 0xcec577d1 /* "hash" */:
+			solver.mSpatialHash = true;
+			if (aCount >= 2)
+				solver.mCellSize = float(atof(aParam[1]));
+			if (aCount >= 3)
+				solver.mCellCount = atoi(aParam[2]);
+			Collidable::SetSolver(solver);
+			return std::min(aCount, 3);
+
+		default:
+			console->Print("physicsindex: unknown index \"%s\"\n", aParam[0]);
+			return 1;
+		}
+	}
+	else if (solver.mSpatialHash)
+	{
+		console->Print("physicsindex: hash %f %d\n", solver.mCellSize, solver.mCellCount);
+		return 0;
+	}
+	else
+	{
+		console->Print("physicsindex: bbtree\n");
+		return 0;
+	}
+}
+Command commandphysicsindex(0xf263e236 /* "physicsindex" */, CommandPhysicsIndex);
+
+int CommandPhysicsSlop(const char * const aParam[], int aCount)
+{
+	CollidableSolverDef solver(Collidable::GetSolver());
+	const int result = ProcessCommandFloat(solver.mSlop, aParam, aCount, NULL, "physicsslop: %f\n");
+	Collidable::SetSolver(solver);
+	return result;
+}
+Command commandphysicsslop(0xd8e08512 /* "physicsslop" */, CommandPhysicsSlop);
+
 static void PostStepAddToWorld(cpSpace *space, void *key, void *id)
 {
 	Collidable::AddToWorld(reinterpret_cast<unsigned int>(id));
@@ -937,7 +1296,8 @@ void Collidable::AddToWorld(unsigned int aId)
 	CollidableBodyDef def(collidable.mBodyDef);
 
 	// set body position to entity (HACK)
-	if (const Entity *entity = Database::entity.Get(aId))
+	Entity *entity = Database::entity.Get(aId);
+	if (entity)
 	{
 		def.mTransform = entity->GetTransform();
 		def.mVelocity.p = entity->GetVelocity();
@@ -964,7 +1324,9 @@ void Collidable::AddToWorld(unsigned int aId)
 	cpBodySetVelocity(body, cpv(def.mVelocity.p.x, def.mVelocity.p.y));
 	cpBodySetAngularVelocity(body, def.mVelocity.a);
 
-	cpBodySetUserData(body, reinterpret_cast<void *>(aId));
+	// link the body to its entity for copying back the simulated motion
+	// (the entity outlives the body: deleting an identifier deactivates it first)
+	cpBodySetUserData(body, entity);
 	//if (def.mFixedRotation)
 	//	cpBodySetAngularVelocityLimit(body, 0.0f);
 
@@ -1042,6 +1404,8 @@ void Collidable::AddToWorld(unsigned int aId)
 			a = b;
 		}
 	}
+
+	GetBodyAdded()(aId);
 }
 
 static void RemoveShapeFromWorld(cpBody *body, cpShape *shape, void *data)
@@ -1081,6 +1445,7 @@ void Collidable::RemoveFromWorld(unsigned int aId)
 	}
 	if (cpBody *body = Database::collidablebody.Get(aId))
 	{
+		GetBodyRemoved()(aId);
 		RemoveBodyFromWorld(body);
 	}
 	Database::collidablebody.Delete(aId);
@@ -1091,7 +1456,7 @@ void Collidable::RemoveFromWorld(unsigned int aId)
 
 
 // create collision world
-void Collidable::WorldInit(float aMinX, float aMinY, float aMaxX, float aMaxY, bool aWall)
+void Collidable::WorldInit(float aMinX, float aMinY, float aMaxX, float aMaxY, bool aWall, const CollidableSolverDef &aSolver)
 {
 	// save boundary extents
 	boundary.min.x = aMinX;
@@ -1100,11 +1465,26 @@ void Collidable::WorldInit(float aMinX, float aMinY, float aMaxX, float aMaxY, b
 	boundary.max.y = aMaxY;
 
 	// create physics world
+	// (a hasty space steps like a plain one, so the solver can switch at run time)
+#ifdef COLLIDABLE_HASTY_SPACE
+	world = cpHastySpaceNew();
+#else
 	world = cpSpaceNew();
+#endif
 	cpSpaceSetSleepTimeThreshold(world, 1.0f);
-	cpSpaceSetCollisionSlop(world, 0.0f);	//0.01);
 	cpSpaceSetCollisionBias(world, powf(0.5f, 60.0f));
 
+	++revision;
+
+	// apply solver settings
+	// (the new world starts with a bounding box tree)
+	const CollidableSolverDef prev;
+	solver = aSolver;
+#ifndef COLLIDABLE_HASTY_SPACE
+	solver.mThreaded = false;
+#endif
+	ApplySolver(world, solver, prev);
+
 	// set default collision handler
 	cpCollisionHandler *handler = cpSpaceAddDefaultCollisionHandler(world);
 	handler->beginFunc = BeginContact;
@@ -1139,32 +1519,48 @@ void Collidable::WorldInit(float aMinX, float aMinY, float aMaxX, float aMaxY, b
 
 void Collidable::WorldDone(void)
 {
+#ifdef COLLIDABLE_HASTY_SPACE
+	cpHastySpaceFree(world);
+#else
 	cpSpaceFree(world);
+#endif
 	world = NULL;
+	++revision;
 }
 
 void Collidable::CollideAll(float aStep)
 {
+	PROFILE_ZONE("Collidable::CollideAll");
+
 	// exit if no world
 	if (!world)
 		return;
 
 	// step the physics world
-	cpSpaceStep(world, aStep);
+	// (recording contact events)
+	contacts.clear();
+#ifdef COLLIDABLE_HASTY_SPACE
+	if (solver.mThreaded)
+		cpHastySpaceStep(world, aStep);
+	else
+#endif
+		cpSpaceStep(world, aStep);
 
-	// for each body...
-	for (Database::Typed<cpBody *>::Iterator i(&Database::collidablebody); i.IsValid(); ++i)
+	// for each awake body in the space...
+	// (Chipmunk lists dynamic and kinematic bodies here and keeps sleeping ones out;
+	// AddToWorld only adds dynamic bodies to the space, so static, kinematic,
+	// and sleeping bodies cost nothing here)
 	{
-		// get the body
-		cpBody *body = i.GetValue();
+		PROFILE_ZONE("Collidable::CopyBack");
 
-		// if the body is not sleeping or static...
-		if (!cpBodyIsSleeping(body) && cpBodyGetType(body) != CP_BODY_TYPE_STATIC)
+		cpArray *bodies = world->dynamicBodies;
+		for (int i = 0; i < bodies->num; ++i)
 		{
+			// get the body
+			cpBody *body = static_cast<cpBody *>(bodies->arr[i]);
+
 			// update the entity position (hack)
-			Database::Key id = i.GetKey();
-			Entity *entity = Database::entity.Get(id);
-			if (entity)
+			if (Entity *entity = static_cast<Entity *>(cpBodyGetUserData(body)))
 			{
 				entity->Step();
 				cpFloat ang(cpBodyGetAngle(body));
@@ -1178,6 +1574,12 @@ void Collidable::CollideAll(float aStep)
 		}
 	}
 
+	// signal contacts with the world settled
+	SignalContacts();
+
+	// everything awake may have moved
+	++revision;
+
 #ifdef COLLIDABLE_DEBUG_DRAW
 	//world->DrawDebugData();
 	if (DebugDrawCollidable)
@@ -1239,14 +1641,14 @@ public:
 };
 
 unsigned int Collidable::TestSegment(const Vector2 &aStart, const Vector2 &aEnd, const CollidableFilter &aFilter, unsigned int aId,
-									 float &aLambda, Vector2 &aNormal, cpShape *&aShape)
+									 float &aLambda, Vector2 &aNormal, cpShape *&aShape, float aRadius)
 {
 	// pad the segment
 	const Vector2 pad(0.125f * InvSqrt(aStart.DistSq(aEnd) + FLT_MIN) * (aEnd - aStart));
 
 	// find the closest hit
 	CollidableRayCast raycast(aFilter, aId);
-	cpSpaceSegmentQuery(world, cpv(aStart.x - pad.x, aStart.y - pad.y), cpv(aEnd.x + pad.x, aEnd.y + pad.y), 0.0f,
+	cpSpaceSegmentQuery(world, cpv(aStart.x - pad.x, aStart.y - pad.y), cpv(aEnd.x + pad.x, aEnd.y + pad.y), aRadius,
 		cpShapeFilterNew(aFilter.mGroup, aFilter.mCategories, aFilter.mMask), CollidableRayCast::Query, &raycast);
 
 	// return result
@@ -1276,6 +1678,17 @@ void Collidable::QueryRadius(const Vector2 &aCenter, float aRadius, const Collid
 	cpSpacePointQuery(world, cpv(aCenter.x, aCenter.y), aRadius, cpShapeFilterNew(aFilter.mGroup, aFilter.mCategories, aFilter.mMask), QueryRadiusCallback, &aDelegate);
 }
 
+static void EachShapeCallback(cpBody *body, cpShape *shape, void *data)
+{
+	(*static_cast<Collidable::EachShapeDelegate *>(data))(shape);
+}
+
+// call a delegate for each shape of a body
+void Collidable::EachShape(CollidableBody *aBody, EachShapeDelegate aDelegate)
+{
+	cpBodyEachShape(aBody, EachShapeCallback, &aDelegate);
+}
+
 // is a shape a sensor?
 bool Collidable::IsSensor(CollidableShape *aShape)
 {
@@ -1302,16 +1715,42 @@ Vector2 Collidable::GetCenter(CollidableShape *aShape)
 	return Vector2(float(box.l + box.r) * 0.5f, float(box.b + box.t) * 0.5f);
 }
 
+// get the bounding box of a shape
+AlignedBox2 Collidable::GetBounds(CollidableShape *aShape)
+{
+	cpBB box = cpShapeGetBB(aShape);
+	return AlignedBox2(Vector2(float(box.l), float(box.b)), Vector2(float(box.r), float(box.t)));
+}
+
+// get the distance from a point to a shape and the closest point on it
+float Collidable::GetDistance(CollidableShape *aShape, const Vector2 &aPoint, Vector2 &aClosest)
+{
+	cpPointQueryInfo info;
+	cpFloat distance = cpShapePointQuery(aShape, cpv(aPoint.x, aPoint.y), &info);
+	aClosest = Vector2(float(info.point.x), float(info.point.y));
+	return float(distance);
+}
+
 // set the position of a body
 void Collidable::SetPosition(CollidableBody *aBody, const Vector2 &aPosition)
 {
+	const unsigned int id = GetBodyId(aBody);
+	if (id)
+		GetBodyRemoved()(id);
 	cpBodySetPosition(aBody, cpv(aPosition.x, aPosition.y));
+	if (id)
+		GetBodyAdded()(id);
 }
 
 // set the angle of a body
 void Collidable::SetAngle(CollidableBody *aBody, const float aAngle)
 {
+	const unsigned int id = GetBodyId(aBody);
+	if (id)
+		GetBodyRemoved()(id);
 	cpBodySetAngle(aBody, aAngle);
+	if (id)
+		GetBodyAdded()(id);
 }
 
 // set the linear velocity of a body
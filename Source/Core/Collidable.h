@@ -178,13 +178,48 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element, unsigned int id);
 };
 
+// physics solver settings
+struct CollidableSolverDef
+{
+	CollidableSolverDef()
+		: mThreaded(false)
+		, mThreads(1)
+		, mIterations(10)
+		, mSpatialHash(false)
+		, mCellSize(64.0f)
+		, mCellCount(1000)
+		, mSlop(0.0f)
+	{
+	}
+
+	bool mThreaded;		// step with the multithreaded solver
+	int mThreads;		// solver threads (0 uses one per core; more than one is not deterministic)
+	int mIterations;	// solver iterations
+	bool mSpatialHash;	// index shapes with a spatial hash instead of a bounding box tree
+	float mCellSize;	// spatial hash cell size
+	int mCellCount;		// spatial hash cell count
+	float mSlop;		// allowed collision overlap
+};
+
 namespace Collidable
 {
 	typedef Signal<void (unsigned int id1, unsigned int id2, float t, const Vector2 &contact, const Vector2 &normal)> ContactSignal;
 	typedef Signal<void (unsigned int id1, unsigned int id2, float t)> SeparateSignal;
 
+	// contact event
+	// (recorded during the physics step and signaled to both sides after it)
+	struct ContactEvent
+	{
+		unsigned int mId1;
+		unsigned int mId2;
+		float mTime;
+		Vector2 mContact;
+		Vector2 mNormal;
+		bool mAdd;			// contact added or removed
+	};
+
 	// initialize the physics world
-	void WorldInit(float aMinX, float aMinY, float aMaxX, float aMaxY, bool aWall);
+	void WorldInit(float aMinX, float aMinY, float aMaxX, float aMaxY, bool aWall, const CollidableSolverDef &aSolver);
 
 	// clean up the physics world
 	void WorldDone(void);
@@ -201,6 +236,24 @@ namespace Collidable
 	// get the world boundary
 	GAME_API const AlignedBox2 &GetBoundary(void);
 
+	// get the physics solver settings
+	GAME_API const CollidableSolverDef &GetSolver(void);
+
+	// change the physics solver settings
+	// (applies to the physics world immediately)
+	GAME_API void SetSolver(const CollidableSolverDef &aSolver);
+
+	// get the physics world revision
+	// (changes whenever the world gets replaced or stepped)
+	GAME_API unsigned int GetRevision(void);
+
+	// body change signals
+	// (bodies added, removed, or moved outside the physics step;
+	// removal signals before the shapes are freed, and a move signals a removal then an addition)
+	typedef Signal<void (unsigned int aId)> BodySignal;
+	GAME_API BodySignal &GetBodyAdded(void);
+	GAME_API BodySignal &GetBodyRemoved(void);
+
 	// default filter
 	inline const CollidableFilter &GetDefaultFilter(void)
 	{
@@ -221,9 +274,11 @@ namespace Collidable
 	}
 
 	// test segment for intersection with world shapes
+	// (a nonzero radius sweeps a circle along the segment)
 	GAME_API unsigned int TestSegment(const Vector2 &aStart, const Vector2 &aEnd,
 									  const CollidableFilter &aFilter, unsigned int aId,
-									  float &aLambda, Vector2 &aNormal, CollidableShape *&aShape);
+									  float &aLambda, Vector2 &aNormal, CollidableShape *&aShape,
+									  float aRadius = 0.0f);
 
 	// query all shapes within an axis-aligned bounding box
 	typedef fastdelegate::FastDelegate<void (CollidableShape *aShape)> QueryBoxDelegate;
@@ -233,6 +288,10 @@ namespace Collidable
 	typedef fastdelegate::FastDelegate<void(CollidableShape *aShape, float aRange, const Vector2 &aPoint)> QueryRadiusDelegate;
 	GAME_API void QueryRadius(const Vector2 &aCenter, float aRadius, const CollidableFilter &aFilter, const QueryRadiusDelegate aDelegate);
 
+	// call a delegate for each shape of a body
+	typedef fastdelegate::FastDelegate<void (CollidableShape *aShape)> EachShapeDelegate;
+	GAME_API void EachShape(CollidableBody *aBody, EachShapeDelegate aDelegate);
+
 	// is a shape a sensor?
 	GAME_API bool IsSensor(CollidableShape *aShape);
 
@@ -245,6 +304,13 @@ namespace Collidable
 	// get the center of a shape
 	GAME_API Vector2 GetCenter(CollidableShape *aShape);
 
+	// get the bounding box of a shape
+	GAME_API AlignedBox2 GetBounds(CollidableShape *aShape);
+
+	// get the distance from a point to a shape and the closest point on it
+	// (negative inside the shape; safe from worker threads)
+	GAME_API float GetDistance(CollidableShape *aShape, const Vector2 &aPoint, Vector2 &aClosest);
+
 	// set the position of a body
 	GAME_API void SetPosition(CollidableBody *aBody, const Vector2 &aPosition);
 
@@ -266,6 +332,10 @@ namespace Collidable
 	// apply an impulse to a body
 	GAME_API void ApplyImpulse(CollidableBody *aBody, const Vector2 &aImpulse);
 
+	// get the contact events from the last physics step
+	// (sorted by identifier pair, in the order they were signaled; valid until the next step)
+	GAME_API const std::vector<ContactEvent> &GetContacts(void);
+
 	// control
 	void CollideAll(float aStep);
 };
@@ -273,7 +343,7 @@ namespace Collidable
 namespace Database
 {
 	extern GAME_API Typed<CollidableTemplate> collidabletemplate;
-	extern GAME_API Typed<CollidableBody *> collidablebody;
+	extern GAME_API Dense<CollidableBody *> collidablebody;
 	extern GAME_API Typed<Collidable::ContactSignal> collidablecontactadd;
 	extern GAME_API Typed<Collidable::SeparateSignal> collidablecontactremove;
 }
@@ -1,5 +1,7 @@
 #include "StdAfx.h"
 #include "Controller.h"
+#include "Worker.h"
+#include "Profiler.h"
 
 namespace Database
 {
@@ -11,11 +13,28 @@ static Controller *sHead;
 static Controller *sTail;
 static Controller *sNext;
 
+// controllers per worker batch
+static const size_t CONTROL_BATCH = 16;
+
+// run of parallel controller actions
+static std::vector<Controller::Action> sRun;
+static float sStep;
+
+// control a batch from the run
+static void ControlBatch(size_t aBegin, size_t aEnd)
+{
+	PROFILE_ZONE("Controller::ControlBatch");
+
+	for (size_t i = aBegin; i < aEnd; ++i)
+		(sRun[i])(sStep);
+}
+
 Controller::Controller(unsigned int aId)
 : mId(aId)
 , mNext(NULL)
 , mPrev(NULL)
 , mActive(false)
+, mParallel(false)
 , mAction()
 , mMove(0, 0)
 , mAim(0, 0)
@@ -65,10 +84,31 @@ void Controller::Deactivate(void)
 
 void Controller::ControlAll(float aStep)
 {
+	PROFILE_ZONE("Controller::ControlAll");
+
+	// match the requested worker count
+	if (Worker::GetCount() != CONTROL_THREADS)
+		Worker::Init(CONTROL_THREADS);
+
 	// update all controllers
 	Controller *itor = sHead;
 	while (itor)
 	{
+		// if the next controllers can run in parallel...
+		if (itor->mParallel && CONTROL_THREADS > 0)
+		{
+			// gather the run
+			sRun.clear();
+			for (; itor && itor->mParallel; itor = itor->mNext)
+				sRun.push_back(itor->mAction);
+
+			// control the run on the worker threads
+			// (none of them touches another's state, so the result matches list order)
+			sStep = aStep;
+			Worker::Run(sRun.size(), CONTROL_BATCH, Worker::Job(ControlBatch));
+			continue;
+		}
+
 		// get the next iterator
 		// (in case the entry gets deleted)
 		sNext = itor->mNext;
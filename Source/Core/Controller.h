@@ -15,6 +15,9 @@ private:
 	Controller *mPrev;
 	bool mActive;
 
+	// can run on a worker thread
+	bool mParallel;
+
 	// action
 	Action mAction;
 
@@ -47,6 +50,14 @@ public:
 		return mActive;
 	}
 
+	// allow running on a worker thread
+	// (only for actions that write nothing but their own controller
+	// and records of their own identifier, and only read everything else)
+	void SetParallel(bool aParallel)
+	{
+		mParallel = aParallel;
+	}
+
 	// get identifier
 	unsigned int GetId() const
 	{
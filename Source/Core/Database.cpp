@@ -2,6 +2,7 @@
 #include "Database.h"
 #include "Entity.h"
 #include "Collidable.h"
+#include "Profiler.h"
 
 namespace Database
 {
@@ -13,6 +14,63 @@ namespace Database
 		return databases;
 	}
 
+	// get database of memberships
+	// (wrapped in a function to handle global initialization order)
+	Typed<Membership> &GetMemberships()
+	{
+		static Typed<Membership> memberships;
+		return memberships;
+	}
+
+	// use the membership index for component lifecycle
+	bool usemembership = true;
+
+	// registration revision
+	// (changes whenever a database or initializer registers or unregisters)
+	static unsigned int revision;
+
+	// databases by membership ordinal
+	static Untyped *ordinals[Membership::BITS];
+
+	// assign a membership ordinal to a database
+	size_t AddOrdinal(Untyped *aDatabase)
+	{
+		// make sure the membership database outlives registered databases
+		GetMemberships();
+
+		// find the first free ordinal
+		for (size_t ordinal = 0; ordinal < Membership::BITS; ++ordinal)
+		{
+			if (!ordinals[ordinal])
+			{
+				ordinals[ordinal] = aDatabase;
+				++revision;
+				return ordinal;
+			}
+		}
+
+		// out of ordinals
+		DebugPrint("Out of membership ordinals database=%p\n", aDatabase);
+		assert(false);
+		return Membership::BITS;
+	}
+
+	// release a membership ordinal
+	void RemoveOrdinal(size_t aOrdinal)
+	{
+		if (aOrdinal < Membership::BITS)
+		{
+			ordinals[aOrdinal] = NULL;
+			++revision;
+		}
+	}
+
+	// get the database with a membership ordinal
+	Untyped *GetOrdinal(size_t aOrdinal)
+	{
+		return aOrdinal < Membership::BITS ? ordinals[aOrdinal] : NULL;
+	}
+
 	// name database
 	Typed<std::string> name(0x8d39bde6 /* "name" */);
 
@@ -25,6 +83,12 @@ namespace Database
 	// creator identifier database
 	Typed<Key> creator(0x27d56017 /* "creator" */);
 
+	// derived instance database
+	Typed<unsigned int> derived(0x02240d16 /* "derived" */);
+
+	// configured instance database
+	Typed<bool> configured(0xa857b9fd /* "configured" */);
+
 	// deleted signal
 	Typed<DeleteSignal> deleted(0x84d1546a /* "deleted" */);
 
@@ -79,6 +143,7 @@ namespace Database
 			mPrev = entry;
 			entry = aEntry;
 			db.Close(mDatabaseId);
+			++revision;
 		}
 		Activate::~Activate()
 		{
@@ -87,6 +152,7 @@ namespace Database
 				db.Put(mDatabaseId, mPrev);
 			else
 				db.Delete(mDatabaseId);
+			++revision;
 		}
 
 		Typed<Entry> &PostActivate::GetDB()
@@ -102,6 +168,7 @@ namespace Database
 			mPrev = entry;
 			entry = aEntry;
 			db.Close(mDatabaseId);
+			++revision;
 		}
 		PostActivate::~PostActivate()
 		{
@@ -110,6 +177,7 @@ namespace Database
 				db.Put(mDatabaseId, mPrev);
 			else
 				db.Delete(mDatabaseId);
+			++revision;
 		}
 
 		Typed<Entry> &PreDeactivate::GetDB()
@@ -125,6 +193,7 @@ namespace Database
 			mPrev = entry;
 			entry = aEntry;
 			db.Close(mDatabaseId);
+			++revision;
 		}
 		PreDeactivate::~PreDeactivate()
 		{
@@ -133,6 +202,7 @@ namespace Database
 				db.Put(mDatabaseId, mPrev);
 			else
 				db.Delete(mDatabaseId);
+			++revision;
 		}
 
 		Typed<Entry> &Deactivate::GetDB()
@@ -148,6 +218,7 @@ namespace Database
 			mPrev = entry;
 			entry = aEntry;
 			db.Close(mDatabaseId);
+			++revision;
 		}
 		Deactivate::~Deactivate()
 		{
@@ -156,6 +227,7 @@ namespace Database
 				db.Put(mDatabaseId, mPrev);
 			else
 				db.Delete(mDatabaseId);
+			++revision;
 		}
 	}
 
@@ -172,9 +244,296 @@ namespace Database
 	// deletion queue
 	std::deque<unsigned int> deletequeue;
 
+	// instance being activated and the number of instances it has derived so far
+	static Key activating;
+	static unsigned int activatingcount;
+
+	// identifiers to reuse for the instances each creator derives, by creation order
+	// (zero for instances to skip while restricted)
+	static Typed<std::vector<Key> > reusederived;
+	static bool restrictderived;
+
+	// process queued activations
+	void ActivateQueued();
+
+	// gather the databases with records for an identifier
+	// (including records inherited through the parent chain)
+	static void GatherMembership(unsigned int aId, Membership &aMembership)
+	{
+		const Typed<Membership> &memberships = GetMemberships();
+
+		// own records
+		if (const Membership *membership = memberships.FindLocal(aId))
+			aMembership = *membership;
+
+		// inherited records
+		if (parent.GetCount())
+		{
+			for (Key id = parent.Get(aId); id != 0; id = parent.Get(id))
+			{
+				if (const Membership *membership = memberships.FindLocal(id))
+					aMembership |= *membership;
+			}
+		}
+	}
+
+	// initializer phases
+	enum Phase
+	{
+		PHASE_ACTIVATE,
+		PHASE_POSTACTIVATE,
+		PHASE_PREDEACTIVATE,
+		PHASE_DEACTIVATE,
+		PHASE_COUNT
+	};
+
+	// initializer sequence
+	// (initializers in registration order, resolved to database ordinals)
+	class Sequence
+	{
+	public:
+		typedef Typed<Initializer::Entry> &(*GetDBFunc)(void);
+		typedef std::pair<size_t, Initializer::Entry> Item;
+
+	private:
+		GetDBFunc mGetDB;			// initializer database
+		Phase mPhase;				// initializer phase
+		unsigned int mRevision;		// registration revision when built
+		std::vector<Item> mItems;	// resolved initializers
+		Membership mMask;			// databases with an initializer
+
+	private:
+		// resolve initializers to database ordinals
+		void Build(void)
+		{
+			mItems.clear();
+			mMask = Membership();
+			for (Typed<Initializer::Entry>::Iterator itor(&mGetDB()); itor.IsValid(); ++itor)
+			{
+				if (Initializer::Entry initializer = itor.GetValue())
+				{
+					Untyped *database = GetDatabases().Get(itor.GetKey());
+					if (database && database->GetOrdinal() < Membership::BITS)
+					{
+						mItems.push_back(Item(database->GetOrdinal(), initializer));
+						mMask.Set(database->GetOrdinal());
+					}
+				}
+			}
+			mRevision = revision;
+		}
+
+		// call initializers for databases with a record
+		// (scanning every initializer)
+		void Scan(unsigned int aId)
+		{
+			// for each initializer...
+			for (Typed<Initializer::Entry>::Iterator itor(&mGetDB()); itor.IsValid(); ++itor)
+			{
+				// get the initializer
+				if (Initializer::Entry initializer = itor.GetValue())
+				{
+					// get the corresponding database
+					Untyped *database = GetDatabases().Get(itor.GetKey());
+
+					// if the database exists and has a record...
+					if (database && database->Find(aId))
+					{
+						// call the initializer
+						initializer(aId);
+					}
+				}
+			}
+		}
+
+	public:
+		Sequence(GetDBFunc aGetDB, Phase aPhase)
+			: mGetDB(aGetDB), mPhase(aPhase), mRevision(~0U)
+		{
+		}
+
+		// get resolved initializers
+		const std::vector<Item> &GetItems(void)
+		{
+			// rebuild if registration changed
+			if (mRevision != revision)
+				Build();
+			return mItems;
+		}
+
+		// call initializers for databases with a record
+		void Run(unsigned int aId);
+	};
+
+	// initializer sequences
+	static Sequence sequences[PHASE_COUNT] =
+	{
+		Sequence(Initializer::Activate::GetDB, PHASE_ACTIVATE),
+		Sequence(Initializer::PostActivate::GetDB, PHASE_POSTACTIVATE),
+		Sequence(Initializer::PreDeactivate::GetDB, PHASE_PREDEACTIVATE),
+		Sequence(Initializer::Deactivate::GetDB, PHASE_DEACTIVATE),
+	};
+
+	// template instantiation plan
+	// (databases and initializers for a template, resolved once)
+	struct Plan
+	{
+		unsigned int mRevision;				// registration revision when built
+		Membership mMembership;				// databases with records for the template
+		std::vector<Untyped *> mDatabases;	// databases with records, in ordinal order
+		std::vector<Initializer::Entry> mInitializers[PHASE_COUNT];	// initializers to call, in order
+		std::vector<Untyped *> mInstanceDatabases;	// databases an activated instance had records in
+
+		Plan(void)
+			: mRevision(~0U)
+		{
+		}
+	};
+
+	// get database of plans
+	// (plans are only marked stale while running, so callers can hold on to them)
+	static Typed<Plan> &GetPlans()
+	{
+		static Typed<Plan> plans;
+		return plans;
+	}
+
+	// get the plan for a template
+	static const Plan &GetPlan(Key aTemplateId)
+	{
+		Typed<Plan> &plans = GetPlans();
+		Plan *plan = const_cast<Plan *>(plans.FindLocal(aTemplateId));
+		if (!plan)
+		{
+			plans.Put(aTemplateId, Plan());
+			plan = const_cast<Plan *>(plans.FindLocal(aTemplateId));
+		}
+
+		// if the plan is stale...
+		if (plan->mRevision != revision)
+		{
+			// gather databases with records
+			plan->mMembership = Membership();
+			GatherMembership(aTemplateId, plan->mMembership);
+			plan->mDatabases.clear();
+			for (size_t ordinal = plan->mMembership.Next(0); ordinal < Membership::BITS; ordinal = plan->mMembership.Next(ordinal + 1))
+				plan->mDatabases.push_back(GetOrdinal(ordinal));
+
+			// gather initializers for those databases
+			for (int phase = 0; phase < PHASE_COUNT; ++phase)
+			{
+				const std::vector<Sequence::Item> &items = sequences[phase].GetItems();
+				std::vector<Initializer::Entry> &initializers = plan->mInitializers[phase];
+				initializers.clear();
+				for (size_t i = 0; i < items.size(); ++i)
+				{
+					if (plan->mMembership.Test(items[i].first))
+						initializers.push_back(items[i].second);
+				}
+			}
+
+			// forget what instances looked like
+			plan->mInstanceDatabases.clear();
+
+			plan->mRevision = revision;
+		}
+
+		return *plan;
+	}
+
+	// invalidate the plan for a template
+	void InvalidatePlan(unsigned int aTemplateId)
+	{
+		if (Plan *plan = const_cast<Plan *>(GetPlans().FindLocal(aTemplateId)))
+			plan->mRevision = ~0U;
+	}
+
+	// invalidate all plans
+	void InvalidatePlans(void)
+	{
+		++revision;
+	}
+
+	// call initializers for databases with a record
+	void Sequence::Run(unsigned int aId)
+	{
+		if (!usemembership)
+		{
+			Scan(aId);
+			return;
+		}
+
+		// get the identifier's own records
+		const Membership *own = GetMemberships().FindLocal(aId);
+
+		// if the identifier has a template...
+		if (Key aTemplateId = parent.GetCount() ? parent.Get(aId) : 0)
+		{
+			// if the template plan covers the identifier's own initialized records...
+			// (getting the plan brings the sequences up to date)
+			const Plan &plan = GetPlan(aTemplateId);
+			if (!own || plan.mMembership.Covers(*own, mMask))
+			{
+				// call the planned initializers
+				// (indexed since a nested rebuild may refill the list)
+				const std::vector<Initializer::Entry> &initializers = plan.mInitializers[mPhase];
+				for (size_t i = 0; i < initializers.size(); ++i)
+					initializers[i](aId);
+				return;
+			}
+		}
+
+		// rebuild if registration changed
+		if (mRevision != revision)
+			Build();
+
+		// get the identifier's membership
+		Membership membership;
+		GatherMembership(aId, membership);
+
+		// for each initializer with a record...
+		for (size_t i = 0; i < mItems.size(); ++i)
+		{
+			if (membership.Test(mItems[i].first))
+			{
+				// call the initializer
+				mItems[i].second(aId);
+			}
+		}
+	}
+
+	// generate an instance identifier
+	static unsigned int GenerateId(unsigned int aTemplateId, unsigned int aCreatorId)
+	{
+		// if the creator is activating...
+		if (aCreatorId && aCreatorId == activating)
+		{
+			// take the reused identifier for this instance if there is one
+			const std::vector<Key> *ids = reusederived.FindLocal(aCreatorId);
+			const unsigned int aInstanceId = ids && activatingcount < ids->size() ? (*ids)[activatingcount] : 0;
+			if (aInstanceId)
+				return aInstanceId;
+
+			// skip the instance if restricted
+			// (it was gone when the snapshot got saved; counting it keeps later instances in order)
+			if (restrictderived)
+			{
+				++activatingcount;
+				return 0;
+			}
+		}
+
+		// hash a new tag with the template identifier
+		const unsigned int aInstanceTag = Entity::TakeId();
+		return Hash(&aInstanceTag, sizeof(aInstanceTag), aTemplateId);
+	}
+
 	// instantiate a template
 	void Instantiate(unsigned int aInstanceId, unsigned int aTemplateId, unsigned int aOwnerId, unsigned int aCreatorId, float aAngle, Vector2 aPosition, Vector2 aVelocity, float aOmega, bool aActivate)
 	{
+		// take an instance handle
+		TakeHandle(aInstanceId);
+
 		// set parent
 		parent.Put(aInstanceId, aTemplateId);
 
@@ -184,6 +543,10 @@ namespace Database
 		// set creator
 		creator.Put(aInstanceId, aCreatorId);
 
+		// if the creator is activating, mark the instance as derived
+		if (aCreatorId && aCreatorId == activating)
+			derived.Put(aInstanceId, activatingcount++);
+
 		// create a new entity
 		Entity *entity = new Entity(aInstanceId);
 		entity->SetTransform(aAngle, aPosition);
@@ -203,8 +566,9 @@ namespace Database
 	unsigned int Instantiate(unsigned int aTemplateId, unsigned int aOwnerId, unsigned int aCreatorId, float aAngle, Vector2 aPosition, Vector2 aVelocity, float aOmega, bool aActivate)
 	{
 		// generate an instance identifier
-		const unsigned int aInstanceTag = Entity::TakeId();
-		const unsigned int aInstanceId = Hash(&aInstanceTag, sizeof(aInstanceTag), aTemplateId);
+		const unsigned int aInstanceId = GenerateId(aTemplateId, aCreatorId);
+		if (!aInstanceId)
+			return 0;
 
 		// instantiate the template
 		Instantiate(aInstanceId, aTemplateId, aOwnerId, aCreatorId, aAngle, aPosition, aVelocity, aOmega, aActivate);
@@ -213,22 +577,178 @@ namespace Database
 		return aInstanceId;
 	}
 
+	// reserve capacity for a batch of instances of a template
+	void ReserveBatch(unsigned int aTemplateId, size_t aCount)
+	{
+		if (aCount == 0)
+			return;
+
+		// reserve capacity in the databases every instance gets
+		parent.Reserve(aCount);
+		owner.Reserve(aCount);
+		creator.Reserve(aCount);
+		entity.Reserve(aCount);
+		GetMemberships().Reserve(aCount);
+
+		// reserve capacity in the databases previous instances ended up in
+		if (usemembership)
+		{
+			const Plan &plan = GetPlan(aTemplateId);
+			for (size_t i = 0; i < plan.mInstanceDatabases.size(); ++i)
+				plan.mInstanceDatabases[i]->Reserve(aCount);
+		}
+	}
+
+	// instantiate a batch of instances of a template
+	void InstantiateBatch(unsigned int aTemplateId, unsigned int aOwnerId, unsigned int aCreatorId, size_t aCount, const Transform2 aTransforms[], const Transform2 aVelocities[], unsigned int aInstanceIds[], bool aActivate)
+	{
+		if (aCount == 0)
+			return;
+
+		// reserve capacity up front
+		ReserveBatch(aTemplateId, aCount);
+
+		// defer activation if busy
+		const bool idle = activatequeue.empty();
+
+		// for each instance...
+		unsigned int aFirstId = 0;
+		for (size_t i = 0; i < aCount; ++i)
+		{
+			// generate an instance identifier
+			const unsigned int aInstanceId = GenerateId(aTemplateId, aCreatorId);
+			if (aInstanceIds)
+				aInstanceIds[i] = aInstanceId;
+			if (!aInstanceId)
+				continue;
+			if (!aFirstId)
+				aFirstId = aInstanceId;
+
+			// instantiate the template without activating
+			const Transform2 &transform = aTransforms[i];
+			const Transform2 velocity = aVelocities ? aVelocities[i] : Transform2(0, Vector2(0, 0));
+			Instantiate(aInstanceId, aTemplateId, aOwnerId, aCreatorId, transform.a, transform.p, velocity.p, velocity.a, false);
+
+			// queue activation
+			if (aActivate)
+				activatequeue.push_back(aInstanceId);
+		}
+
+		// process queued activations
+		if (aActivate && runtime && idle)
+			ActivateQueued();
+
+		// remember the databases the first instance ended up in
+		if (usemembership)
+		{
+			Plan &plan = const_cast<Plan &>(GetPlan(aTemplateId));
+			if (plan.mInstanceDatabases.empty())
+			{
+				if (const Membership *membership = GetMemberships().FindLocal(aFirstId))
+				{
+					for (size_t ordinal = membership->Next(0); ordinal < Membership::BITS; ordinal = membership->Next(ordinal + 1))
+						plan.mInstanceDatabases.push_back(GetOrdinal(ordinal));
+				}
+			}
+		}
+	}
+
+	// does an identifier descend from another through its parent chain?
+	static bool DescendsFrom(Key aId, Key aAncestorId)
+	{
+		for (Key id = aId; id != 0; id = parent.Get(id))
+		{
+			if (id == aAncestorId)
+				return true;
+		}
+		return false;
+	}
+
 	// inherit from a template
 	void Inherit(unsigned int aInstanceId, unsigned int aTemplateId)
 	{
-		// for each registered database...
-		for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
+		if (aTemplateId == 0 || aTemplateId == aInstanceId)
+			return;
+
+		// if the identifier already inherits from the template, its records already refer to it
+		const Key *aParentId = parent.FindLocal(aInstanceId);
+		if (aParentId && *aParentId == aTemplateId)
+			return;
+
+		// if the identifier has no parent and the template does not descend from it...
+		if (!aParentId && !DescendsFrom(aTemplateId, aInstanceId))
 		{
-			// get the database
-			Untyped *database = itor.GetValue();
+			// the template's records still replace ones the identifier already has
+			// (keeping the precedence of copying them over)
+			if (usemembership)
+			{
+				if (const Membership *found = GetMemberships().FindLocal(aInstanceId))
+				{
+					const Membership membership(*found);
+					for (size_t ordinal = membership.Next(0); ordinal < Membership::BITS; ordinal = membership.Next(ordinal + 1))
+					{
+						Untyped *database = GetOrdinal(ordinal);
+						if (const void *data = database->Find(aTemplateId))
+							database->Put(aInstanceId, data);
+					}
+				}
+			}
+			else
+			{
+				for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
+				{
+					Untyped *database = itor.GetValue();
+					if (database->FindLocal(aInstanceId))
+					{
+						if (const void *data = database->Find(aTemplateId))
+							database->Put(aInstanceId, data);
+					}
+				}
+			}
 
-			// if the database has a record for the template...
-			if (const void *data = database->Find(aTemplateId))
+			// refer to the template's records instead of copying them
+			// (Open copies a record the first time the identifier writes it)
+			parent.Put(aInstanceId, aTemplateId);
+
+			// the instance's records changed
+			InvalidatePlan(aInstanceId);
+			return;
+		}
+
+		// if using the membership index...
+		if (usemembership)
+		{
+			// for each database with a record for the template...
+			const Plan &plan = GetPlan(aTemplateId);
+			for (size_t i = 0; i < plan.mDatabases.size(); ++i)
 			{
+				// get the database
+				Untyped *database = plan.mDatabases[i];
+
 				// duplicate into the instance
-				database->Put(aInstanceId, data);
+				if (const void *data = database->Find(aTemplateId))
+					database->Put(aInstanceId, data);
+			}
+		}
+		else
+		{
+			// for each registered database...
+			for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
+			{
+				// get the database
+				Untyped *database = itor.GetValue();
+
+				// if the database has a record for the template...
+				if (const void *data = database->Find(aTemplateId))
+				{
+					// duplicate into the instance
+					database->Put(aInstanceId, data);
+				}
 			}
 		}
+
+		// the instance's records changed
+		InvalidatePlan(aInstanceId);
 	}
 
 	// change an instance's type
@@ -242,23 +762,16 @@ namespace Database
 	// activate immediately
 	void ActivateImmediate(unsigned int aId)
 	{
-		// for each activation initializer...
-		for (Typed<Initializer::Entry>::Iterator itor(&Initializer::Activate::GetDB()); itor.IsValid(); ++itor)
-		{
-			// get the initializer
-			if (Initializer::Entry initializer = itor.GetValue())
-			{
-				// get the corresponding database
-				Untyped *database = GetDatabases().Get(itor.GetKey());
+		PROFILE_ZONE("Database::Activate");
 
-				// if the database exists and has a record...
-				if (database && database->Find(aId))
-				{
-					// call the initializer
-					initializer(aId);
-				}
-			}
-		}
+		// track instances derived during activation
+		const Key prevactivating = activating;
+		const unsigned int prevactivatingcount = activatingcount;
+		activating = aId;
+		activatingcount = 0;
+
+		// call activation initializers
+		sequences[PHASE_ACTIVATE].Run(aId);
 
 		// if entity has no physics...
 		if (!Database::collidablebody.Get(aId))
@@ -271,23 +784,12 @@ namespace Database
 			entity->Step();
 		}
 
-		// for each post-activation initializer...
-		for (Typed<Initializer::Entry>::Iterator itor(&Initializer::PostActivate::GetDB()); itor.IsValid(); ++itor)
-		{
-			// get the initializer
-			if (Initializer::Entry initializer = itor.GetValue())
-			{
-				// get the corresponding database
-				Untyped *database = GetDatabases().Get(itor.GetKey());
+		// call post-activation initializers
+		sequences[PHASE_POSTACTIVATE].Run(aId);
 
-				// if the database exists and has a record...
-				if (database && database->Find(aId))
-				{
-					// call the initializer
-					initializer(aId);
-				}
-			}
-		}
+		// stop tracking
+		activating = prevactivating;
+		activatingcount = prevactivatingcount;
 	}
 
 	// process queued activations
@@ -321,44 +823,52 @@ namespace Database
 		ActivateQueued();
 	}
 
-	// deactivate immediately
-	void DeactivateImmediate(unsigned int aId)
+	// activate a batch of identifiers
+	void ActivateBatch(size_t aCount, const unsigned int aIds[])
 	{
-		// for each pre-deactivation initializer...
-		for (Typed<Initializer::Entry>::Iterator itor(&Initializer::PreDeactivate::GetDB()); itor.IsValid(); ++itor)
-		{
-			// get the initializer
-			if (Initializer::Entry initializer = itor.GetValue())
-			{
-				// get the corresponding database
-				Untyped *database = GetDatabases().Get(itor.GetKey());
+		// defer activation if busy
+		const bool idle = activatequeue.empty();
 
-				// if the database exists and has a record...
-				if (database && database->Find(aId))
-				{
-					// call the initializer
-					initializer(aId);
-				}
-			}
-		}
+		// queue activations
+		for (size_t i = 0; i < aCount; ++i)
+			activatequeue.push_back(aIds[i]);
 
-		// for each deactivation initializer...
-		for (Typed<Initializer::Entry>::Iterator itor(&Initializer::Deactivate::GetDB()); itor.IsValid(); ++itor)
-		{
-			// get the initializer
-			if (Initializer::Entry initializer = itor.GetValue())
-			{
-				// get the corresponding database
-				Untyped *database = GetDatabases().Get(itor.GetKey());
+		// process queued activations
+		if (runtime && idle)
+			ActivateQueued();
+	}
 
-				// if the database exists and has a record...
-				if (database && database->Find(aId))
-				{
-					// call the initializer
-					initializer(aId);
-				}
-			}
-		}
+	// reuse an identifier for an instance a creator derives
+	void ReuseDerived(unsigned int aCreatorId, unsigned int aDerived, unsigned int aInstanceId)
+	{
+		std::vector<Key> &ids = reusederived.Open(aCreatorId);
+		if (ids.size() <= aDerived)
+			ids.resize(aDerived + 1, 0);
+		ids[aDerived] = aInstanceId;
+		reusederived.Close(aCreatorId);
+	}
+
+	// derive only instances with reused identifiers
+	void RestrictDerived(bool aRestrict)
+	{
+		restrictderived = aRestrict;
+	}
+
+	// discard identifiers left to reuse
+	void ClearDerived(void)
+	{
+		reusederived.Clear();
+		restrictderived = false;
+	}
+
+	// deactivate immediately
+	void DeactivateImmediate(unsigned int aId)
+	{
+		// call pre-deactivation initializers
+		sequences[PHASE_PREDEACTIVATE].Run(aId);
+
+		// call deactivation initializers
+		sequences[PHASE_DEACTIVATE].Run(aId);
 	}
 
 	// process queued deactivations
@@ -404,15 +914,38 @@ namespace Database
 			delete entity;
 		}
 
-		// for each registered database...
-		for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
+		// if using the membership index...
+		if (usemembership)
 		{
-			// get the database
-			Untyped *database = itor.GetValue();
+			// if the identifier has any records...
+			if (const Membership *found = GetMemberships().FindLocal(aId))
+			{
+				// copy the membership since deleting records updates it
+				Membership membership(*found);
 
-			// delete the record
-			database->Delete(aId);
+				// for each database with a record...
+				for (size_t ordinal = membership.Next(0); ordinal < Membership::BITS; ordinal = membership.Next(ordinal + 1))
+				{
+					// delete the record
+					GetOrdinal(ordinal)->Delete(aId);
+				}
+			}
 		}
+		else
+		{
+			// for each registered database...
+			for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
+			{
+				// get the database
+				Untyped *database = itor.GetValue();
+
+				// delete the record
+				database->Delete(aId);
+			}
+		}
+
+		// release the instance handle
+		ReleaseHandle(aId);
 	}
 
 	// process queued deletions
@@ -451,11 +984,65 @@ namespace Database
 	// update the database system
 	void Update(void)
 	{
+		PROFILE_ZONE("Database::Update");
+
 		ActivateQueued();
 		DeactivateQueued();
 		DeleteQueued();
 	}
 
+	namespace Statistics
+	{
+		// statistics output file
+		static FILE *csv;
+
+		// start writing per-turn statistics
+		bool OpenCSV(const char *aFileName)
+		{
+			CloseCSV();
+			csv = fopen(aFileName, "w");
+			if (!csv)
+				return false;
+			collectstatistics = true;
+			fprintf(csv, "turn,id,count,limit,stride,grows,lookups,probeavg,probemax,bytes\n");
+			return true;
+		}
+
+		// stop writing statistics
+		void CloseCSV(void)
+		{
+			if (csv)
+			{
+				fclose(csv);
+				csv = NULL;
+			}
+		}
+
+		// write statistics and reset lookup counters
+		void Update(unsigned int aTurn)
+		{
+			// for each registered database...
+			for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
+			{
+				const Untyped *database = itor.GetValue();
+
+				// write a row
+				if (csv)
+				{
+					fprintf(csv, "%u,0x%08x,%u,%u,%u,%u,%u,%.3f,%u,%u\n",
+						aTurn, database->GetId(),
+						unsigned(database->GetCount()), unsigned(database->GetLimit()), unsigned(database->GetStride()),
+						unsigned(database->GetGrowCount()), unsigned(database->GetLookupCount()),
+						database->GetProbeAverage(), unsigned(database->GetProbeMax()),
+						unsigned(database->GetBytes()));
+				}
+
+				// start counting the next turn
+				database->ResetStatistics();
+			}
+		}
+	}
+
 	// clean up all databases
 	void Cleanup(void)
 	{
@@ -474,5 +1061,14 @@ namespace Database
 		// clear all registered databases
 		for (Typed<Untyped *>::Iterator itor(&GetDatabases()); itor.IsValid(); ++itor)
 			itor.GetValue()->Clear();
+
+		// release all instance handles
+		ClearHandles();
+
+		// discard all plans
+		GetPlans().Clear();
+
+		// discard identifiers left to reuse
+		ClearDerived();
 	}
 }
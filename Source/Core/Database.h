@@ -81,6 +81,34 @@ namespace Database
 	// get database of databases
 	Typed<Untyped *> &GetDatabases();
 
+	// get database of memberships
+	Typed<Membership> &GetMemberships();
+
+	// database membership ordinals
+	size_t AddOrdinal(Untyped *aDatabase);
+	void RemoveOrdinal(size_t aOrdinal);
+	Untyped *GetOrdinal(size_t aOrdinal);
+
+	// instance handles
+	GAME_API Handle TakeHandle(Key aKey);
+	GAME_API void ReleaseHandle(Key aKey);
+	GAME_API void ClearHandles(void);
+	GAME_API Handle GetHandle(Key aKey);
+	GAME_API Key GetKey(Handle aHandle);
+	GAME_API bool IsValid(Handle aHandle);
+
+	// index a database by instance handle
+	// (declare after the database it indexes)
+	class GAME_API HandleIndex
+	{
+	public:
+		HandleIndex(Untyped &aDatabase);
+	};
+
+	// use the membership index for component lifecycle
+	// (disable to scan every database, for comparison)
+	extern GAME_API bool usemembership;
+
 	// name database
 	extern GAME_API Typed<std::string> name;
 
@@ -93,22 +121,56 @@ namespace Database
 	// creator identifier database
 	extern GAME_API Typed<Key> creator;
 
+	// derived instance database
+	// (instances created while their creator activated, numbered in creation order)
+	extern GAME_API Typed<unsigned int> derived;
+
+	// configured instance database
+	// (instances created from level <entity> elements, which hold the records they configured)
+	extern GAME_API Typed<bool> configured;
+
 	// deletion signal
 	typedef Signal<void (Key)> DeleteSignal;
 	extern GAME_API Typed<DeleteSignal> deleted;
 
 	// instantiate a template
 	void GAME_API Instantiate(unsigned int aInstanceId, unsigned int aTemplateId, unsigned int aOwnerId, unsigned int aCreatorId, float aAngle, Vector2 aPosition, Vector2 aVelocity = Vector2(0, 0), float aOmega = 0, bool aActivate = true);
+	// (returns zero if a restricted restore skipped the instance)
 	unsigned int GAME_API Instantiate(unsigned int aTemplateId, unsigned int aOwnerId, unsigned int aCreatorId, float aAngle, Vector2 aPosition, Vector2 aVelocity = Vector2(0, 0), float aOmega = 0, bool aActivate = true);
 
+	// reserve capacity for a batch of instances of a template
+	// (in the common databases and the ones earlier instances ended up in)
+	void GAME_API ReserveBatch(unsigned int aTemplateId, size_t aCount);
+
+	// instantiate a batch of instances of a template
+	// (reserves database capacity up front and activates the batch in one pass)
+	void GAME_API InstantiateBatch(unsigned int aTemplateId, unsigned int aOwnerId, unsigned int aCreatorId, size_t aCount, const Transform2 aTransforms[], const Transform2 aVelocities[] = NULL, unsigned int aInstanceIds[] = NULL, bool aActivate = true);
+
+	// reuse an identifier for an instance a creator derives, by creation order
+	// (lets a snapshot restore give derived instances their original identifiers;
+	// while restricted, creators skip deriving the instances that have none)
+	void GAME_API ReuseDerived(unsigned int aCreatorId, unsigned int aDerived, unsigned int aInstanceId);
+	void GAME_API RestrictDerived(bool aRestrict);
+	void GAME_API ClearDerived(void);
+
 	// inherit from a template
+	// (an identifier without a parent refers to the template's records and copies
+	// each one on first Open; otherwise the template's records are copied)
 	void GAME_API Inherit(unsigned int aInstanceId, unsigned int aTemplateId);
 
+	// invalidate cached template instantiation plans
+	// (call after reconfiguring a template)
+	void GAME_API InvalidatePlan(unsigned int aTemplateId);
+	void GAME_API InvalidatePlans(void);
+
 	// change an instance's type
 	void GAME_API Switch(unsigned int aInstanceId, unsigned int aTemplateId);
 
 	// activate an identifier
 	void GAME_API Activate(unsigned int aId);
+
+	// activate a batch of identifiers
+	void GAME_API ActivateBatch(size_t aCount, const unsigned int aIds[]);
 	
 	// deactivate an identifier
 	void GAME_API Deactivate(unsigned int aId);
@@ -119,6 +181,19 @@ namespace Database
 	// update the database system
 	void Update(void);
 
+	// database statistics
+	namespace Statistics
+	{
+		// start writing per-turn statistics for every registered database as CSV
+		GAME_API bool OpenCSV(const char *aFileName);
+
+		// stop writing statistics
+		GAME_API void CloseCSV(void);
+
+		// write statistics gathered since the last update (if writing) and reset lookup counters
+		GAME_API void Update(unsigned int aTurn);
+	}
+
 	// clean up all databases
 	void Cleanup(void);
 }
@@ -23,6 +23,17 @@ namespace Database
 		{
 			static_cast<T *>(aDest)->~T();
 		}
+		virtual void MoveRecord(void *aDest, void *aSource)
+		{
+			new (aDest) T(*static_cast<const T *>(aSource));
+			static_cast<T *>(aSource)->~T();
+		}
+
+		Typed(unsigned int aId, unsigned int aBits, Storage aStorage)
+			: Untyped(aId, sizeof(T), aBits, aStorage == DENSE)
+		{
+			CreateRecord(mNil);
+		}
 
 	public:
 		Typed(void)
@@ -81,11 +92,26 @@ namespace Database
 			return static_cast<const T *>(Untyped::Find(aKey));
 		}
 
+		const T *Find(Handle aHandle) const
+		{
+			return static_cast<const T *>(Untyped::Find(aHandle));
+		}
+
+		const T *FindLocal(Key aKey) const
+		{
+			return static_cast<const T *>(Untyped::FindLocal(aKey));
+		}
+
 		const T &Get(Key aKey) const
 		{
 			return *static_cast<const T *>(Untyped::Get(aKey));
 		}
 
+		const T &Get(Handle aHandle) const
+		{
+			return *static_cast<const T *>(Untyped::Get(aHandle));
+		}
+
 		void Put(Key aKey, const T &aValue)
 		{
 			Untyped::Put(aKey, &aValue);
@@ -133,4 +159,26 @@ namespace Database
 			}
 		};
 	};
+
+	// dense typed database
+	// (records stored contiguously in slot order for fast iteration;
+	// record references are invalidated whenever a record is added or deleted)
+	template <typename T> class Dense : public Typed<T>
+	{
+	public:
+		Dense(void)
+			: Typed<T>(0, 4, Untyped::DENSE)
+		{
+		}
+
+		Dense(unsigned int aId)
+			: Typed<T>(aId, 8, Untyped::DENSE)
+		{
+		}
+
+		Dense(unsigned int aId, unsigned int aBits)
+			: Typed<T>(aId, aBits, Untyped::DENSE)
+		{
+		}
+	};
 }
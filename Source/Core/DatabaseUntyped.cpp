@@ -8,6 +8,9 @@ namespace Database
 	// UNTYPED DATABASE
 	//
 
+	// collect lookup statistics
+	bool collectstatistics = false;
+
 #ifdef USE_POOL_ALLOCATOR
 	// pool of pools
 	static MemoryPool &GetPoolPool(void)
@@ -26,8 +29,9 @@ namespace Database
 #endif
 
 	// constructor
-	Untyped::Untyped(unsigned int aId, size_t aStride, size_t aBits)
-		: mId(aId), mBits(aBits), mLimit(1 << mBits), mCount(0), mMask((2 << mBits) - 1)
+	Untyped::Untyped(unsigned int aId, size_t aStride, size_t aBits, bool aDense)
+		: mId(aId), mOrdinal(Membership::BITS), mBits(aBits), mLimit(1 << mBits), mCount(0), mMask(GroupMask(mBits)), mDense(aDense), mHandleLimit(0), mHandleSlot(NULL), mSlotHandle(NULL)
+		, mGrowCount(0), mLookupCount(0), mProbeCount(0), mProbeMax(0)
 	{
 		// if allocating...
 		if (signed(aBits) >= 0)
@@ -39,9 +43,10 @@ namespace Database
 			Alloc();
 
 			// fill with empty values
-			memset(mMap, EMPTY, mLimit * 2 * sizeof(size_t));
+			memset(mCtrl, CTRL_EMPTY, GetMapSize());
 			memset(mKey, 0, mLimit * sizeof(Key));
-			memset(mData, 0, mLimit * sizeof(void *));
+			if (!mDense)
+				memset(mData, 0, mLimit * sizeof(void *));
 			memset(mNil, 0, GetStride());
 		}
 		else
@@ -50,24 +55,41 @@ namespace Database
 			mPool = NULL;
 
 			// clear pointers
+			mCtrl = NULL;
 			mMap = NULL;
 			mKey = NULL;
 			mData = NULL;
+			mBlock = NULL;
 			mNil = NULL;
 		}
 
 		if (mId)
+		{
 			GetDatabases().Put(mId, this);
+			mOrdinal = AddOrdinal(this);
+		}
 	}
 
 	// destructor
 	Untyped::~Untyped()
 	{
 		if (mId)
+		{
 			GetDatabases().Delete(mId);
+			RemoveOrdinal(mOrdinal);
+			mOrdinal = Membership::BITS;
+		}
 
 		Free();
 
+		if (mHandleSlot)
+		{
+			free(mHandleSlot);
+			mHandleSlot = NULL;
+			free(mSlotHandle);
+			mSlotHandle = NULL;
+		}
+
 		if (mPool)
 		{
 			mPool->Release();
@@ -78,15 +100,30 @@ namespace Database
 	// allocate pools
 	void Untyped::Alloc()
 	{
-		mMap = static_cast<size_t *>(malloc(mLimit * 2 * sizeof(size_t)));
+		mCtrl = static_cast<unsigned char *>(malloc(GetMapSize()));
+		mMap = static_cast<MapEntry *>(malloc(GetMapSize() * sizeof(MapEntry)));
 		mKey = static_cast<Key *>(malloc(mLimit * sizeof(Key)));
-		mData = static_cast<void **>(malloc(mLimit * sizeof(void *)));
+		if (mDense)
+		{
+			mData = NULL;
+			mBlock = static_cast<char *>(malloc(mLimit * GetStride()));
+		}
+		else
+		{
+			mData = static_cast<void **>(malloc(mLimit * sizeof(void *)));
+			mBlock = NULL;
+		}
 		mNil = malloc(GetStride());
 	}
 
 	// free pools
 	void Untyped::Free()
 	{
+		if (mCtrl)
+		{
+			free(mCtrl);
+			mCtrl = NULL;
+		}
 		if (mMap)
 		{
 			free(mMap);
@@ -102,6 +139,11 @@ namespace Database
 			free(mData);
 			mData = NULL;
 		}
+		if (mBlock)
+		{
+			free(mBlock);
+			mBlock = NULL;
+		}
 		if (mNil)
 		{
 			free(mNil);
@@ -116,11 +158,20 @@ namespace Database
 		{
 			void *record = GetRecord(slot);
 			DeleteRecord(record);
-			mPool->Free(record);
+			if (!mDense)
+				mPool->Free(record);
+			if (mOrdinal < Membership::BITS)
+				RemoveMember(mKey[slot]);
 		}
-		memset(mMap, EMPTY, mLimit * 2 * sizeof(size_t));
+		memset(mCtrl, CTRL_EMPTY, GetMapSize());
 		memset(mKey, 0, mLimit * sizeof(Key));
-		memset(mData, 0, mLimit * sizeof(void *));
+		if (!mDense)
+			memset(mData, 0, mLimit * sizeof(void *));
+		if (mHandleSlot)
+		{
+			memset(mHandleSlot, EMPTY, mHandleLimit * sizeof(size_t));
+			memset(mSlotHandle, 0xFF, mLimit * sizeof(unsigned int));
+		}
 		mCount = 0;
 	}
 
@@ -130,40 +181,78 @@ namespace Database
 	{
 		// resize
 		++mBits;
-		mMask = (2 << mBits) - 1;
+		mMask = GroupMask(mBits);
 		mLimit = 1 << mBits;
+		++mGrowCount;
 
 		DebugPrint("Grow database this=%p id=%08x stride=%d chunk=%d limit=%d count=%d\n",
 			this, mId, GetStride(), GetChunk(), GetLimit(), GetCount());
 
 		// reallocate map
+		free(mCtrl);
+		mCtrl = static_cast<unsigned char *>(malloc(GetMapSize()));
+		memset(mCtrl, CTRL_EMPTY, GetMapSize());
 		free(mMap);
-		mMap = static_cast<size_t *>(malloc(mLimit * 2 * sizeof(size_t)));
-		memset(mMap, EMPTY, mLimit * 2 * sizeof(size_t));
+		mMap = static_cast<MapEntry *>(malloc(GetMapSize() * sizeof(MapEntry)));
 
 		// reallocate keys
-		mKey = static_cast<Key *>(realloc(mKey, mLimit * sizeof(size_t)));
-		memset(mKey + mCount, 0, (mLimit - mCount) * sizeof(size_t));
+		mKey = static_cast<Key *>(realloc(mKey, mLimit * sizeof(Key)));
+		memset(mKey + mCount, 0, (mLimit - mCount) * sizeof(Key));
+
+		// reallocate slot handles
+		if (mSlotHandle)
+		{
+			mSlotHandle = static_cast<unsigned int *>(realloc(mSlotHandle, mLimit * sizeof(unsigned int)));
+			memset(mSlotHandle + mCount, 0xFF, (mLimit - mCount) * sizeof(unsigned int));
+		}
 
 		// reallocate data
-		mData = static_cast<void **>(realloc(mData, mLimit * sizeof(void *)));
-		memset(mData + mCount, 0, (mLimit - mCount) * sizeof(void *));
+		if (mDense)
+		{
+			// move records into a new block
+			// (records may not be relocatable with a raw copy)
+			char *block = static_cast<char *>(malloc(mLimit * GetStride()));
+			for (size_t slot = 0; slot < mCount; ++slot)
+				MoveRecord(block + slot * GetStride(), GetRecord(slot));
+			free(mBlock);
+			mBlock = block;
+		}
+		else
+		{
+			mData = static_cast<void **>(realloc(mData, mLimit * sizeof(void *)));
+			memset(mData + mCount, 0, (mLimit - mCount) * sizeof(void *));
+		}
 
 		// rebuild hash
 		for (size_t record = 0; record < mCount; ++record)
 		{
-			// get the record key
-			size_t key = mKey[record];
-
-			// convert key to a hash map index
-			// (HACK: assume key is already a hash)
-			size_t index = FindIndex(key);
-
 			// insert the record key
-			mMap[index] = record;
+			InsertEntry(mKey[record], record);
 		}
 	}
 
+	// get the number of bytes the database uses
+	size_t Untyped::GetBytes(void) const
+	{
+		if (!mMap)
+			return 0;
+		size_t bytes = GetMapSize() * (sizeof(MapEntry) + 1) + mLimit * sizeof(Key) + mHandleLimit * sizeof(size_t);
+		if (mSlotHandle)
+			bytes += mLimit * sizeof(unsigned int);
+		if (mDense)
+			bytes += mLimit * GetStride();
+		else
+			bytes += mLimit * sizeof(void *) + mCount * GetStride();
+		return bytes;
+	}
+
+	// make room for a number of additional records
+	void Untyped::Reserve(size_t aCount)
+	{
+		while (mCount + aCount > mLimit)
+			Grow();
+	}
+
 	// copy a source database
 	void Untyped::Copy(const Untyped &aSource)
 	{
@@ -180,6 +269,9 @@ namespace Database
 		mPool = aSource.mPool;
 		mPool->AddRef();
 
+		// copy storage mode
+		mDense = aSource.mDense;
+
 		// copy counts
 		mBits = aSource.mBits;
 		mMask = aSource.mMask;
@@ -190,19 +282,33 @@ namespace Database
 		Alloc();
 
 		// copy map
-		memcpy(mMap, aSource.mMap, mLimit * 2 * sizeof(size_t));
+		memcpy(mCtrl, aSource.mCtrl, GetMapSize());
+		memcpy(mMap, aSource.mMap, GetMapSize() * sizeof(MapEntry));
 
 		// copy keys
-		memcpy(mKey, aSource.mKey, mLimit * sizeof(size_t));
-		memset(mKey + mCount, 0, (mLimit - mCount) * sizeof(size_t));
+		memcpy(mKey, aSource.mKey, mLimit * sizeof(Key));
+		memset(mKey + mCount, 0, (mLimit - mCount) * sizeof(Key));
 
 		// copy data
 		for (size_t slot = 0; slot < mCount; ++slot)
 		{
-			mData[slot] = mPool->Alloc();
+			if (!mDense)
+				mData[slot] = mPool->Alloc();
 			CreateRecord(GetRecord(slot), aSource.GetRecord(slot));
+			if (mOrdinal < Membership::BITS)
+				AddMember(mKey[slot]);
+		}
+		if (!mDense)
+			memset(mData + mCount, 0, (mLimit - mCount) * sizeof(void *));
+
+		// invalidate the handle index
+		// (lookups fall back to the key)
+		if (mHandleSlot)
+		{
+			memset(mHandleSlot, EMPTY, mHandleLimit * sizeof(size_t));
+			mSlotHandle = static_cast<unsigned int *>(realloc(mSlotHandle, mLimit * sizeof(unsigned int)));
+			memset(mSlotHandle, 0xFF, mLimit * sizeof(unsigned int));
 		}
-		memset(mData + mCount, 0, (mLimit - mCount) * sizeof(void *));
 
 		// copy default
 		CreateRecord(mNil, aSource.mNil);
@@ -231,6 +337,48 @@ namespace Database
 		return NULL;
 	}
 
+	// find the record for a specified handle
+	const void *Untyped::Find(Handle aHandle) const
+	{
+		// if the handle is indexed...
+		if (mHandleSlot && aHandle.mIndex < mHandleLimit && IsValid(aHandle))
+		{
+			// if the slot is not empty...
+			size_t slot = mHandleSlot[aHandle.mIndex];
+			if (slot != EMPTY)
+			{
+				// return the record
+				return GetRecord(slot);
+			}
+		}
+
+		// fall back to the key
+		if (Key aKey = GetKey(aHandle))
+			return Find(aKey);
+
+		// not found
+		return NULL;
+	}
+
+	// find the record for a specified key
+	// (ignoring records inherited from the parent)
+	const void *Untyped::FindLocal(Key aKey) const
+	{
+		// convert key to a slot
+		// (HACK: assume key is already a hash)
+		size_t slot = FindSlot(aKey);
+
+		// if the slot is not empty...
+		if (slot != EMPTY)
+		{
+			// return the record
+			return GetRecord(slot);
+		}
+
+		// not found
+		return NULL;
+	}
+
 	// get the record for a specified key (or default if not found)
 	const void *Untyped::Get(Key aKey) const
 	{
@@ -254,6 +402,29 @@ namespace Database
 		return mNil;
 	}
 
+	// get the record for a specified handle (or default if not found)
+	const void *Untyped::Get(Handle aHandle) const
+	{
+		// if the handle is indexed...
+		if (mHandleSlot && aHandle.mIndex < mHandleLimit && IsValid(aHandle))
+		{
+			// if the slot is not empty...
+			size_t slot = mHandleSlot[aHandle.mIndex];
+			if (slot != EMPTY)
+			{
+				// return the record
+				return GetRecord(slot);
+			}
+		}
+
+		// fall back to the key
+		if (Key aKey = GetKey(aHandle))
+			return Get(aKey);
+
+		// not found
+		return mNil;
+	}
+
 	// create or update a record for a specified key
 	void Untyped::Put(Key aKey, const void *aValue)
 	{
@@ -346,20 +517,29 @@ namespace Database
 	{
 		// convert key to a hash map index
 		// (HACK: assume key is already a hash)
-		size_t index = FindIndex(aKey);
+		size_t index = FindEntry(aKey);
 
-		// if the slot is empty...
-		size_t slot = mMap[index];
-		if (slot == EMPTY)
+		// if the entry is empty...
+		if (index == EMPTY)
 		{
 			// not found
 			return;
 		}
+		size_t slot = mMap[index].mSlot;
 
 		// delete the record
 		void *record = GetRecord(slot);
 		DeleteRecord(record);
-		mPool->Free(record);
+		if (!mDense)
+			mPool->Free(record);
+
+		// update membership
+		if (mOrdinal < Membership::BITS)
+			RemoveMember(aKey);
+
+		// update handle index
+		if (mHandleSlot)
+			UnindexHandle(slot);
 
 		// update record count
 		--mCount;
@@ -369,48 +549,142 @@ namespace Database
 		{
 			// move the last record into the vacant slot
 			Key key = mKey[slot] = mKey[mCount];
-			mData[slot] = mData[mCount];
+			if (mDense)
+				MoveRecord(record, mBlock + mCount * GetStride());
+			else
+				mData[slot] = mData[mCount];
+			if (mHandleSlot && mSlotHandle[mCount] != ~0U)
+			{
+				// (the moved record keeps its handle)
+				mSlotHandle[slot] = mSlotHandle[mCount];
+				mSlotHandle[mCount] = ~0U;
+				mHandleSlot[mSlotHandle[slot]] = slot;
+			}
 
 			// update the map
-			for (size_t keyindex = Index(key); mMap[keyindex] != EMPTY; keyindex = Next(keyindex))
+			mMap[FindEntry(key)].mSlot = static_cast<unsigned int>(slot);
+		}
+
+		// clear the last record
+		if (!mDense)
+			mData[mCount] = NULL;
+		mKey[mCount] = 0;
+
+		// remove the map entry
+		RemoveEntry(index);
+	}
+
+	// remove a map entry
+	// (shifts later entries back instead of leaving a tombstone)
+	void Untyped::RemoveEntry(size_t aIndex)
+	{
+		size_t holegroup = aIndex / GROUP;
+
+		// while the hole breaks a probe sequence...
+		// (probes stop at the first group with an empty entry)
+		while (!MatchEmpty(holegroup))
+		{
+			// for each later group in the cluster...
+			size_t moved = EMPTY;
+			for (size_t group = (holegroup + 1) & mMask; group != holegroup; group = (group + 1) & mMask)
 			{
-				if (mMap[keyindex] == mCount)
+				// if an entry can move back into the hole...
+				// (its home group is at or before the hole's group)
+				const size_t distance = (group - holegroup) & mMask;
+				for (size_t i = 0; i < GROUP; ++i)
 				{
-					mMap[keyindex] = slot;
-					break;
+					const size_t index = group * GROUP + i;
+					if (mCtrl[index] != CTRL_EMPTY && ((group - Group(mMap[index].mKey)) & mMask) >= distance)
+					{
+						moved = index;
+						break;
+					}
 				}
+
+				// stop upon finding one or reaching the end of the cluster
+				if (moved != EMPTY || MatchEmpty(group))
+					break;
 			}
+
+			// stop if nothing needs to move
+			if (moved == EMPTY)
+				break;
+
+			// move the entry into the hole
+			mCtrl[aIndex] = mCtrl[moved];
+			mMap[aIndex] = mMap[moved];
+
+			// the vacated entry becomes the new hole
+			aIndex = moved;
+			holegroup = aIndex / GROUP;
 		}
 
-		// clear the last record
-		mData[mCount] = NULL;
-		mKey[mCount] = 0;
+		// clear the empty entry
+		mCtrl[aIndex] = CTRL_EMPTY;
+	}
+
+	// add this database to a key's membership
+	void Untyped::AddMember(Key aKey)
+	{
+		// (allocate directly so the record does not inherit from the parent)
+		Typed<Membership> &memberships = GetMemberships();
+		Membership *membership = const_cast<Membership *>(memberships.FindLocal(aKey));
+		if (!membership)
+			membership = static_cast<Membership *>(memberships.Alloc(aKey));
+		membership->Set(mOrdinal);
+	}
 
-		// for each entry in the cluster...
-		size_t nextindex = index;
-		while (1)
+	// remove this database from a key's membership
+	void Untyped::RemoveMember(Key aKey)
+	{
+		Typed<Membership> &memberships = GetMemberships();
+		if (Membership *membership = const_cast<Membership *>(memberships.FindLocal(aKey)))
 		{
-			// get the next entry
-			nextindex = Next(nextindex);
-			size_t nextslot = mMap[nextindex];
+			membership->Reset(mOrdinal);
+			if (membership->IsEmpty())
+				memberships.Delete(aKey);
+		}
+	}
 
-			// stop upon reaching the end of the cluster
-			if (nextslot == EMPTY)
-				break;
+	// index records by instance handle
+	// (records added from now on are found by handle without probing)
+	void Untyped::IndexHandles(void)
+	{
+		if (mHandleSlot)
+			return;
+		mHandleLimit = 256;
+		mHandleSlot = static_cast<size_t *>(malloc(mHandleLimit * sizeof(size_t)));
+		memset(mHandleSlot, EMPTY, mHandleLimit * sizeof(size_t));
+		mSlotHandle = static_cast<unsigned int *>(malloc(mLimit * sizeof(unsigned int)));
+		memset(mSlotHandle, 0xFF, mLimit * sizeof(unsigned int));
+	}
 
-			// if the entry is out of place, and there is a place for it...
-			Key key = mKey[nextslot];
-			size_t keyindex = Index(key);
-			if ((nextindex > index && (keyindex <= index || keyindex > nextindex)) ||
-				(nextindex < index && (keyindex <= index && keyindex > nextindex)))
-			{
-				// move the entry
-				mMap[index] = mMap[nextindex];
-				index = nextindex;
-			}
+	// add a record to the handle index
+	// (the slot remembers its handle, so deletes and moves need no handle lookup)
+	void Untyped::IndexHandle(Handle aHandle, size_t aSlot)
+	{
+		mSlotHandle[aSlot] = aHandle.mIndex;
+		if (aHandle.IsNull())
+			return;
+
+		// grow the index if needed
+		if (aHandle.mIndex >= mHandleLimit)
+		{
+			size_t limit = std::max<size_t>(mHandleLimit * 2, aHandle.mIndex + 1);
+			mHandleSlot = static_cast<size_t *>(realloc(mHandleSlot, limit * sizeof(size_t)));
+			memset(mHandleSlot + mHandleLimit, EMPTY, (limit - mHandleLimit) * sizeof(size_t));
+			mHandleLimit = limit;
 		}
 
-		// clear the empty slot
-		mMap[index] = EMPTY;
+		mHandleSlot[aHandle.mIndex] = aSlot;
+	}
+
+	// remove a record from the handle index
+	void Untyped::UnindexHandle(size_t aSlot)
+	{
+		unsigned int index = mSlotHandle[aSlot];
+		if (index < mHandleLimit)
+			mHandleSlot[index] = EMPTY;
+		mSlotHandle[aSlot] = ~0U;
 	}
 }
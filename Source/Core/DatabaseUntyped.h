@@ -1,12 +1,31 @@
 #pragma once
 
 #include "MemoryPool.h"
+#include "Handle.h"
+
+#include <atomic>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// compile in database lookup statistics
+// (probe lengths for key lookups while Database::collectstatistics is set;
+// grow events are always counted)
+#define DATABASE_COLLECT_STATISTICS
 
 namespace Database
 {
 	// database key
 	typedef unsigned int Key;
 
+	// collect lookup statistics
+	// (off by default; costs one test per lookup while off)
+	extern GAME_API bool collectstatistics;
+
+	// instance handle for a key (see Database.h)
+	GAME_API Handle GetHandle(Key aKey);
+
 	// reference-counted memory pool
 	class MemoryPoolRef : public MemoryPool
 	{
@@ -48,91 +67,307 @@ namespace Database
 #endif
 	};
 
+	// database membership
+	// (set of registered databases holding a record for a key)
+	class Membership
+	{
+	public:
+		static const size_t BITS = 256;
+		static const size_t WORDS = BITS / 32;
+
+	protected:
+		unsigned int mWord[WORDS];
+
+	public:
+		Membership(void)
+		{
+			memset(mWord, 0, sizeof(mWord));
+		}
+
+		bool Test(size_t aBit) const
+		{
+			return (mWord[aBit >> 5] & (1U << (aBit & 31))) != 0;
+		}
+
+		void Set(size_t aBit)
+		{
+			mWord[aBit >> 5] |= 1U << (aBit & 31);
+		}
+
+		void Reset(size_t aBit)
+		{
+			mWord[aBit >> 5] &= ~(1U << (aBit & 31));
+		}
+
+		bool IsEmpty(void) const
+		{
+			for (size_t word = 0; word < WORDS; ++word)
+				if (mWord[word])
+					return false;
+			return true;
+		}
+
+		// does this contain every bit of the source within the mask?
+		bool Covers(const Membership &aSource, const Membership &aMask) const
+		{
+			for (size_t word = 0; word < WORDS; ++word)
+				if (aSource.mWord[word] & aMask.mWord[word] & ~mWord[word])
+					return false;
+			return true;
+		}
+
+		const Membership &operator|=(const Membership &aSource)
+		{
+			for (size_t word = 0; word < WORDS; ++word)
+				mWord[word] |= aSource.mWord[word];
+			return *this;
+		}
+
+		// get the first set bit at or after the specified bit
+		// (returns BITS if there are none)
+		size_t Next(size_t aBit) const
+		{
+			for (size_t word = aBit >> 5; word < WORDS; ++word)
+			{
+				unsigned int bits = mWord[word];
+				if (word == aBit >> 5)
+					bits &= ~0U << (aBit & 31);
+				if (bits)
+				{
+					size_t bit = word << 5;
+					while (!(bits & 1))
+					{
+						bits >>= 1;
+						++bit;
+					}
+					return bit;
+				}
+			}
+			return BITS;
+		}
+	};
+
 	// untyped (core) database
 	class GAME_API Untyped
 	{
+	public:
+		// record storage mode
+		enum Storage
+		{
+			SPARSE,		// records allocated individually from the pool
+			DENSE		// records stored contiguously in slot order
+		};
+
 	protected:
 		const unsigned int mId;
+		size_t mOrdinal;	// membership ordinal (registered databases only)
 
 		static const size_t EMPTY = ~0U;
 
+		// hash map entry
+		// (key stored inline with its record slot so a probe touches a single entry)
+		struct MapEntry
+		{
+			Key mKey;
+			unsigned int mSlot;
+		};
+
+		// hash map probe group
+		// (control bytes for a group are matched 16 at a time with SSE2)
+		static const size_t GROUP = 16;
+		static const unsigned char CTRL_EMPTY = 0x80;
+
 		MemoryPoolRef *mPool;	// (shared) memory pool
 
 		size_t mBits;		// bit count
 		size_t mLimit;		// maximum number of database records (1 << bit count)
 		size_t mCount;		// current number of database records
-		size_t mMask;		// map index mask
-		size_t *mMap;		// map key to database records (2x maximum)
+		size_t mMask;		// map group index mask
+		unsigned char *mCtrl;	// map control bytes (key fragment, or empty)
+		MapEntry *mMap;		// map key to database records (2x maximum)
 		Key *mKey;			// database record key pool
 		void **mData;		// database record data pool
+		char *mBlock;		// database record data block (dense mode)
+		bool mDense;		// store records contiguously in slot order?
 		void *mNil;			// database default record
 
+		size_t mHandleLimit;	// size of the handle index
+		size_t *mHandleSlot;	// map handle index to database records (direct-indexed only)
+		unsigned int *mSlotHandle;	// handle index of each database record (~0U if none)
+
+		size_t mGrowCount;				// number of grow events
+		mutable std::atomic<size_t> mLookupCount;	// number of key lookups since reset
+		mutable std::atomic<size_t> mProbeCount;	// number of map entries probed since reset
+		mutable std::atomic<size_t> mProbeMax;		// longest probe since reset
+
 	protected:
 		void Alloc(void);
 		void Free(void);
 		void Grow(void);
 		void Copy(const Untyped &aSource);
+		void AddMember(Key aKey);
+		void RemoveMember(Key aKey);
+		void IndexHandle(Handle aHandle, size_t aSlot);
+		void UnindexHandle(size_t aSlot);
+
+		void RemoveEntry(size_t aIndex);
 
-		inline size_t Index(Key aKey) const
+		// get the map group index mask for a bit count
+		// (the map holds twice the maximum record count, and at least one group)
+		static size_t GroupMask(size_t aBits)
 		{
-			// convert key to a hash map index
+			return aBits >= 3 ? (2 << aBits) / GROUP - 1 : 0;
+		}
+
+		// get the number of map entries
+		inline size_t GetMapSize(void) const
+		{
+			return (mMask + 1) * GROUP;
+		}
+
+		inline size_t Group(Key aKey) const
+		{
+			// convert key to a home group
 			// (HACK: assume key is already a hash)
 			return ((aKey >> (mBits + 1)) ^ aKey) & mMask;
 		}
 
-		inline size_t Next(size_t aIndex) const
+		inline unsigned char Fragment(Key aKey) const
 		{
-			return (aIndex + 1) & mMask;
+			// take the top 7 key bits for the control byte
+			// (independent of the home group bits)
+			return static_cast<unsigned char>(aKey >> 25);
 		}
 
-		inline size_t FindIndex(Key aKey) const
+		inline static unsigned int LowestBit(unsigned int aMask)
 		{
-			size_t index = Index(aKey);
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, aMask);
+			return index;
+#else
+			return __builtin_ctz(aMask);
+#endif
+		}
+
+		// get a bit mask of group entries with a given control byte
+		inline unsigned int MatchGroup(size_t aGroup, unsigned char aCtrl) const
+		{
+			const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mCtrl + aGroup * GROUP));
+			return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(char(aCtrl)))));
+		}
 
-			// while the slot is not empty...
-			size_t slot = mMap[index];
-			while (slot != EMPTY && mKey[slot] != aKey)
+		// get a bit mask of empty group entries
+		// (only the empty control byte has its high bit set)
+		inline unsigned int MatchEmpty(size_t aGroup) const
+		{
+			const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mCtrl + aGroup * GROUP));
+			return unsigned(_mm_movemask_epi8(ctrl));
+		}
+
+		// find the map entry for a key
+		// (returns EMPTY if not found)
+		inline size_t FindEntry(Key aKey) const
+		{
+			const unsigned char fragment = Fragment(aKey);
+			size_t group = Group(aKey);
+#ifdef DATABASE_COLLECT_STATISTICS
+			size_t probe = 1;
+#endif
+			size_t found = EMPTY;
+
+			// while the key is not found...
+			for (;;)
 			{
-				index = Next(index);
-				slot = mMap[index];
+				// check entries with a matching fragment
+				for (unsigned int match = MatchGroup(group, fragment); match; match &= match - 1)
+				{
+					const size_t index = group * GROUP + LowestBit(match);
+					if (mMap[index].mKey == aKey)
+					{
+						found = index;
+						break;
+					}
+				}
+
+				// stop if found or if the group has room
+				// (an insert would have stopped here)
+				if (found != EMPTY || MatchEmpty(group))
+					break;
+
+				// advance to the next group
+				group = (group + 1) & mMask;
+#ifdef DATABASE_COLLECT_STATISTICS
+				++probe;
+#endif
 			}
 
-			return index;
+#ifdef DATABASE_COLLECT_STATISTICS
+			if (collectstatistics)
+				CountLookup(probe);
+#endif
+			return found;
+		}
+
+		// count a key lookup
+		// (relaxed atomics, since control worker threads look up keys too)
+		void CountLookup(size_t aProbe) const
+		{
+			mLookupCount.fetch_add(1, std::memory_order_relaxed);
+			mProbeCount.fetch_add(aProbe, std::memory_order_relaxed);
+			size_t probemax = mProbeMax.load(std::memory_order_relaxed);
+			while (probemax < aProbe && !mProbeMax.compare_exchange_weak(probemax, aProbe, std::memory_order_relaxed))
+				;
 		}
 
 		inline size_t FindSlot(Key aKey) const
 		{
-			size_t index = Index(aKey);
+			const size_t index = FindEntry(aKey);
+			return index != EMPTY ? mMap[index].mSlot : EMPTY;
+		}
 
-			// while the slot is not empty...
-			size_t slot = mMap[index];
-			while (slot != EMPTY && mKey[slot] != aKey)
+		// add a map entry for a key
+		// (takes the first empty entry along the probe sequence)
+		inline void InsertEntry(Key aKey, size_t aSlot)
+		{
+			size_t group = Group(aKey);
+			unsigned int empty = MatchEmpty(group);
+			while (!empty)
 			{
-				index = Next(index);
-				slot = mMap[index];
+				group = (group + 1) & mMask;
+				empty = MatchEmpty(group);
 			}
-
-			return slot;
+			const size_t index = group * GROUP + LowestBit(empty);
+			mCtrl[index] = Fragment(aKey);
+			mMap[index].mKey = aKey;
+			mMap[index].mSlot = static_cast<unsigned int>(aSlot);
 		}
 
 		void *AllocRecord(Key aKey)
 		{
 			size_t slot = mCount++;
-			size_t index = FindIndex(aKey);
-			_ASSERTE(index >= 0 && index < mLimit * 2);
-			_ASSERTE(mMap[index] == EMPTY);
-			mMap[index] = slot;
+			_ASSERTE(FindEntry(aKey) == EMPTY);
+			InsertEntry(aKey, slot);
 			_ASSERTE(slot >= 0 && slot < mCount);
 			_ASSERTE(mKey[slot] == 0);
 			mKey[slot] = aKey;
-			_ASSERTE(mData[slot] == NULL);
-			mData[slot] = mPool->Alloc();
+			if (!mDense)
+			{
+				_ASSERTE(mData[slot] == NULL);
+				mData[slot] = mPool->Alloc();
+			}
+			if (mOrdinal < Membership::BITS)
+				AddMember(aKey);
+			if (mHandleSlot)
+				IndexHandle(GetHandle(aKey), slot);
 			return memset(GetRecord(slot), 0, GetStride());
 		}
 
 		inline void *GetRecord(size_t aSlot) const
 		{
 			_ASSERTE(aSlot >= 0 && aSlot < mCount);
+			if (mDense)
+				return mBlock + aSlot * GetStride();
 			_ASSERTE(mData[aSlot] != NULL);
 			return mData[aSlot];
 		}
@@ -153,9 +388,13 @@ namespace Database
 		virtual void DeleteRecord(void *aDest)
 		{
 		};
+		virtual void MoveRecord(void *aDest, void *aSource)
+		{
+			memcpy(aDest, aSource, GetStride());
+		}
 
 	public:
-		Untyped(unsigned int aId, size_t aStride, size_t aBits);
+		Untyped(unsigned int aId, size_t aStride, size_t aBits, bool aDense = false);
 		Untyped(const Untyped &aSource);
 		virtual ~Untyped();
 
@@ -183,14 +422,62 @@ namespace Database
 		{
 			return mCount;
 		}
+		size_t GetOrdinal(void) const
+		{
+			return mOrdinal;
+		}
+		bool IsDense(void) const
+		{
+			return mDense;
+		}
+		unsigned int GetId(void) const
+		{
+			return mId;
+		}
+
+		// statistics
+		size_t GetGrowCount(void) const
+		{
+			return mGrowCount;
+		}
+		size_t GetLookupCount(void) const
+		{
+			return mLookupCount.load(std::memory_order_relaxed);
+		}
+		size_t GetProbeCount(void) const
+		{
+			return mProbeCount.load(std::memory_order_relaxed);
+		}
+		size_t GetProbeMax(void) const
+		{
+			return mProbeMax.load(std::memory_order_relaxed);
+		}
+		float GetProbeAverage(void) const
+		{
+			const size_t lookups = GetLookupCount();
+			return lookups ? float(GetProbeCount()) / float(lookups) : 0.0f;
+		}
+		size_t GetBytes(void) const;
+		void ResetStatistics(void) const
+		{
+			mLookupCount.store(0, std::memory_order_relaxed);
+			mProbeCount.store(0, std::memory_order_relaxed);
+			mProbeMax.store(0, std::memory_order_relaxed);
+		}
 
 		const void *Find(Key aKey) const;
+		const void *Find(Handle aHandle) const;
+		const void *FindLocal(Key aKey) const;
 		const void *Get(Key aKey) const;
+		const void *Get(Handle aHandle) const;
 		void Put(Key aKey, const void *aValue);
 		void *Open(Key aKey);
 		void Close(Key aKey);
 		void *Alloc(Key aKey);
 		void Delete(Key aKey);
+		void Reserve(size_t aCount);
+
+		void IndexHandles(void);
 
 		const void *GetDefault(void) const
 		{
@@ -0,0 +1,178 @@
+#include "StdAfx.h"
+#include "Digest.h"
+#include "Entity.h"
+#include "Profiler.h"
+#include "PerfTimer.h"
+
+namespace Digest
+{
+	// lane constants
+	static const unsigned int PRIME1 = 0x9e3779b1;
+	static const unsigned int PRIME2 = 0x85ebca77;
+	static const unsigned int PRIME3 = 0xc2b2ae3d;
+
+	// rotate left
+	static inline unsigned int Rotate(unsigned int aValue, int aShift)
+	{
+		return (aValue << aShift) | (aValue >> (32 - aShift));
+	}
+
+	// mix a word into a lane
+	static inline unsigned int Round(unsigned int aLane, unsigned int aWord)
+	{
+		return Rotate(aLane + aWord * PRIME2, 13) * PRIME1;
+	}
+
+	Hasher::Hasher(unsigned int aSeed)
+		: mCount(0)
+	{
+		mLane[0] = aSeed + PRIME1 + PRIME2;
+		mLane[1] = aSeed + PRIME2;
+		mLane[2] = aSeed;
+		mLane[3] = aSeed - PRIME1;
+	}
+
+	// add raw bytes
+	void Hasher::Add(const void *aData, size_t aSize)
+	{
+		const unsigned char *data = static_cast<const unsigned char *>(aData);
+
+		// whole blocks go to all four lanes
+		while (aSize >= 16)
+		{
+			unsigned int block[4];
+			memcpy(block, data, sizeof(block));
+			for (int i = 0; i < 4; ++i)
+				mLane[i] = Round(mLane[i], block[i]);
+			data += 16;
+			aSize -= 16;
+			mCount += 4;
+		}
+
+		// remaining words go to one lane each
+		while (aSize > 0)
+		{
+			const size_t size = aSize < 4 ? aSize : 4;
+			unsigned int word = 0;
+			memcpy(&word, data, size);
+			mLane[mCount & 3] = Round(mLane[mCount & 3], word);
+			data += size;
+			aSize -= size;
+			++mCount;
+		}
+	}
+
+	// get the hash of everything added
+	unsigned int Hasher::Finish(void) const
+	{
+		unsigned int hash = Rotate(mLane[0], 1) + Rotate(mLane[1], 7) + Rotate(mLane[2], 12) + Rotate(mLane[3], 18) + mCount;
+		hash ^= hash >> 15;
+		hash *= PRIME2;
+		hash ^= hash >> 13;
+		hash *= PRIME3;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	Database::Typed<Entry> &Section::GetDB()
+	{
+		static Database::Typed<Entry> sections;
+		return sections;
+	}
+	Section::Section(unsigned int aSectionId, const char *aName, HashEntry aHash)
+		: mSectionId(aSectionId)
+	{
+		Database::Typed<Entry> &db = GetDB();
+		mHadPrev = db.FindLocal(mSectionId) != NULL;
+		Entry &entry = db.Open(mSectionId);
+		mPrev = entry;
+		entry.mName = aName;
+		entry.mHash = aHash;
+		db.Close(mSectionId);
+	}
+	Section::~Section()
+	{
+		Database::Typed<Entry> &db = GetDB();
+		if (mHadPrev)
+			db.Put(mSectionId, mPrev);
+		else
+			db.Delete(mSectionId);
+	}
+
+	// hash entity identity and motion
+	static unsigned int EntityHash(void)
+	{
+		unsigned int sum = 0;
+		for (Database::Typed<Entity *>::Iterator itor(&Database::entity); itor.IsValid(); ++itor)
+		{
+			const unsigned int aId = itor.GetKey();
+			const Entity *entity = itor.GetValue();
+			const Transform2 &transform = entity->GetTransform();
+			const Vector2 &velocity = entity->GetVelocity();
+			const float motion[6] = { transform.a, transform.p.x, transform.p.y, entity->GetOmega(), velocity.x, velocity.y };
+			Hasher hasher(aId);
+			hasher.Add(motion);
+			sum += hasher.Finish();
+		}
+		return sum;
+	}
+	Section entitysection(0xd33ff5da /* "entity" */, "entity", EntityHash);
+
+	// hash the random number generator state
+	static unsigned int RandomHash(void)
+	{
+		Hasher hasher;
+		hasher.Add(Random::gSeed);
+		return hasher.Finish();
+	}
+	Section randomsection(0x144f0c62 /* "random" */, "random", RandomHash);
+
+	// digest cost
+	static PerfTimer costtimer;
+	static unsigned int costcount;
+
+	// compute the hash of every section
+	void Compute(Values &aValues)
+	{
+		PROFILE_ZONE("Digest::Compute");
+
+		costtimer.Start();
+		aValues.clear();
+		const Database::Typed<Entry> &sections = Section::GetDB();
+		for (Database::Typed<Entry>::Iterator itor(&sections); itor.IsValid(); ++itor)
+		{
+			Value value;
+			value.mSectionId = itor.GetKey();
+			value.mHash = itor.GetValue().mHash();
+			aValues.push_back(value);
+		}
+		costtimer.Stop();
+		++costcount;
+	}
+
+	// reset the digest cost
+	void ResetCost(void)
+	{
+		costtimer.Clear();
+		costcount = 0;
+	}
+
+	// get the time spent computing digests
+	double GetCostSeconds(void)
+	{
+		return double(costtimer.Ticks()) / double(PerfTimer::mFrequency);
+	}
+
+	// get the number of digests computed
+	unsigned int GetCostCount(void)
+	{
+		return costcount;
+	}
+
+	// get the name of a section
+	const char *GetName(unsigned int aSectionId)
+	{
+		const Entry *entry = Section::GetDB().FindLocal(aSectionId);
+		return entry ? entry->mName : NULL;
+	}
+}
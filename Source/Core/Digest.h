@@ -0,0 +1,77 @@
+#pragma once
+
+// world state digest
+// (hashes the simulation state each turn so playback can detect where it diverges from a recording)
+namespace Digest
+{
+	// running hash
+	// (four independent lanes over 32-bit words so the compiler can vectorize the block loop)
+	class GAME_API Hasher
+	{
+	private:
+		unsigned int mLane[4];
+		unsigned int mCount;
+
+	public:
+		Hasher(unsigned int aSeed = 0);
+
+		// add raw bytes
+		void Add(const void *aData, size_t aSize);
+
+		// add a plain value
+		template <typename T> void Add(const T &aValue)
+		{
+			Add(&aValue, sizeof(T));
+		}
+
+		// get the hash of everything added
+		unsigned int Finish(void) const;
+	};
+
+	// section hash function
+	// (sections with many instances hash each one seeded by its identifier and sum the results,
+	// so the digest does not depend on database iteration order)
+	typedef unsigned int (*HashEntry)(void);
+
+	// section entry
+	struct Entry
+	{
+		const char *mName;
+		HashEntry mHash;
+	};
+
+	// digest section
+	class GAME_API Section
+	{
+	private:
+		unsigned int mSectionId;
+		Entry mPrev;
+		bool mHadPrev;
+
+	public:
+		static Database::Typed<Entry> &GetDB();
+		Section(unsigned int aSectionId, const char *aName, HashEntry aHash);
+		~Section();
+	};
+
+	// section hash value
+	struct Value
+	{
+		unsigned int mSectionId;
+		unsigned int mHash;
+	};
+	typedef std::vector<Value> Values;
+
+	// compute the hash of every section
+	GAME_API void Compute(Values &aValues);
+
+	// get the name of a section
+	// (returns null for an unknown section)
+	GAME_API const char *GetName(unsigned int aSectionId);
+
+	// time spent computing digests since the last reset
+	// (so the headless runner can report what recording or checking digests costs)
+	GAME_API void ResetCost(void);
+	GAME_API double GetCostSeconds(void);
+	GAME_API unsigned int GetCostCount(void);
+}
@@ -18,7 +18,8 @@ void Entity::operator delete(void *aPtr)
 
 namespace Database
 {
-	Typed<Entity *> entity(0xd33ff5da /* "entity" */);
+	Dense<Entity *> entity(0xd33ff5da /* "entity" */);
+	HandleIndex entityhandleindex(entity);
 
 	namespace Loader
 	{
@@ -80,6 +81,9 @@ namespace Database
 				if (!ConfigureTemplateItem(child, aId))
 					DebugPrint("template \"%s\" skipping item \"%s\"\n", element->Attribute("name"), child->Value());
 			}
+
+			// discard instantiation plans built from the old configuration
+			Database::InvalidatePlans();
 		}
 		Configure templateconfigure(0x694aaa0b /* "template" */, TemplateConfigure);
 
@@ -109,6 +113,11 @@ namespace Database
 			// objects default to owning themselves
 			Database::owner.Put(aId, aId);
 
+			// take an instance handle
+			// (level entities are published and snapshotted like instantiated ones)
+			Database::TakeHandle(aId);
+			Database::configured.Put(aId, true);
+
 			// create an entity
 			Entity *entity = new Entity(aId);
 			Database::entity.Put(aId, entity);
@@ -134,9 +143,11 @@ namespace Database
 
 
 unsigned int Entity::sNextId = 1;
+std::vector<Entity *> Entity::sMoved;
 
 Entity::Entity(unsigned int id)
-: id(id)
+: mMovedIndex(~0U)
+, id(id)
 , prevtrans(0, Vector2(0, 0))
 , curtrans(0, Vector2(0, 0))
 , veloc(0, Vector2(0, 0))
@@ -145,6 +156,22 @@ Entity::Entity(unsigned int id)
 
 Entity::~Entity(void)
 {
+	// remove from the moved list
+	if (mMovedIndex != ~0U)
+	{
+		Entity *last = sMoved.back();
+		sMoved[mMovedIndex] = last;
+		last->mMovedIndex = mMovedIndex;
+		sMoved.pop_back();
+	}
+}
+
+// clear the moved list
+void Entity::ClearMoved(void)
+{
+	for (std::vector<Entity *>::iterator itor = sMoved.begin(); itor != sMoved.end(); ++itor)
+		(*itor)->mMovedIndex = ~0U;
+	sMoved.clear();
 }
 
 // configure
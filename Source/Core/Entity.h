@@ -6,6 +6,20 @@ private:
 	// next available identifier
 	static unsigned int sNextId;
 
+	// entities moved since the list was last cleared
+	static std::vector<Entity *> sMoved;
+	unsigned int mMovedIndex;
+
+	// add to the moved list
+	void Moved(void)
+	{
+		if (mMovedIndex == ~0U)
+		{
+			mMovedIndex = static_cast<unsigned int>(sMoved.size());
+			sMoved.push_back(this);
+		}
+	}
+
 protected:
 	// identifier
 	unsigned int id;
@@ -35,16 +49,38 @@ public:
 		return sNextId++;
 	}
 
+	// get next identifier without taking it
+	static unsigned int PeekId(void)
+	{
+		return sNextId;
+	}
+
+	// set next identifier
+	static void SetNextId(unsigned int aId)
+	{
+		sNextId = aId;
+	}
+
 	// get identifier
 	unsigned int GetId(void) const
 	{
 		return id;
 	}
 
+	// get entities moved since the list was last cleared
+	static const std::vector<Entity *> &GetMoved(void)
+	{
+		return sMoved;
+	}
+
+	// clear the moved list
+	static void ClearMoved(void);
+
 	// step
 	void Step(void)
 	{
 		prevtrans = curtrans;
+		Moved();
 	}
 
 	// set transform
@@ -52,10 +88,12 @@ public:
 	{
 		curtrans.a = aAngle;
 		curtrans.p = aPosit;
+		Moved();
 	}
 	void SetTransform(const Transform2 &aTransform)
 	{
 		curtrans = aTransform;
+		Moved();
 	}
 
 	// get transform
@@ -74,12 +112,14 @@ public:
 	void SetPrevAngle(float aAngle)
 	{
 		prevtrans.a = aAngle;
+		Moved();
 	}
 
 	// set angle
 	void SetAngle(float aAngle)
 	{
 		curtrans.a = aAngle;
+		Moved();
 	}
 
 	// get previous angle
@@ -121,12 +161,14 @@ public:
 	void SetPrevPosition(const Vector2 &aPos)
 	{
 		prevtrans.p = aPos;
+		Moved();
 	}
 
 	// set position
 	void SetPosition(const Vector2 &aPos)
 	{
 		curtrans.p = aPos;
+		Moved();
 	}
 
 	// get previous position
@@ -172,5 +214,5 @@ public:
 
 namespace Database
 {
-	extern GAME_API Typed<Entity *> entity;
+	extern GAME_API Dense<Entity *> entity;
 }
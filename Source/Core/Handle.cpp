@@ -0,0 +1,159 @@
+#include "StdAfx.h"
+
+#if defined(_MSC_VER)
+#define HANDLE_THREAD_LOCAL __declspec(thread)
+#else
+#define HANDLE_THREAD_LOCAL __thread
+#endif
+
+namespace Database
+{
+	//
+	// HANDLE TABLE
+	//
+
+	// handle table entry
+	struct HandleEntry
+	{
+		Key mKey;					// instance key (0 if free)
+		unsigned int mGeneration;	// incremented on release
+		unsigned int mNextFree;		// next free entry
+	};
+
+	// handle table entries
+	// (wrapped in a function to handle global initialization order)
+	static std::vector<HandleEntry> &GetHandleEntries()
+	{
+		static std::vector<HandleEntry> entries;
+		return entries;
+	}
+
+	// first free handle table entry
+	static unsigned int handlefree = ~0U;
+
+	// handle for each instance key
+	// (wrapped in a function to handle global initialization order)
+	static Typed<Handle> &GetHandles()
+	{
+		static Typed<Handle> handles;
+		return handles;
+	}
+
+	// table entry of the most recently taken or found handle, per thread
+	// (components of an instance are created right after its handle is taken,
+	// so indexing them by handle rarely needs the key lookup; worker threads
+	// look up handles too, so each keeps its own, and a hit is checked against
+	// the table entry, so releasing a handle leaves nothing to invalidate)
+	static HANDLE_THREAD_LOCAL unsigned int lastindex = ~0U;
+
+	// take a handle for an instance key
+	Handle TakeHandle(Key aKey)
+	{
+		// return the existing handle if there is one
+		Typed<Handle> &handles = GetHandles();
+		if (const Handle *handle = handles.FindLocal(aKey))
+			return *handle;
+
+		// reuse a free entry or add a new one
+		std::vector<HandleEntry> &entries = GetHandleEntries();
+		unsigned int index = handlefree;
+		if (index != ~0U)
+		{
+			handlefree = entries[index].mNextFree;
+		}
+		else
+		{
+			index = static_cast<unsigned int>(entries.size());
+			HandleEntry entry = { 0, 0, ~0U };
+			entries.push_back(entry);
+		}
+
+		// bind the entry to the key
+		HandleEntry &entry = entries[index];
+		entry.mKey = aKey;
+		entry.mNextFree = ~0U;
+		Handle handle(index, entry.mGeneration);
+		handles.Put(aKey, handle);
+		lastindex = index;
+		return handle;
+	}
+
+	// release the handle for an instance key
+	// (outstanding copies of the handle become stale)
+	void ReleaseHandle(Key aKey)
+	{
+		Typed<Handle> &handles = GetHandles();
+		const Handle *handle = handles.FindLocal(aKey);
+		if (!handle)
+			return;
+
+		// retire the entry
+		std::vector<HandleEntry> &entries = GetHandleEntries();
+		HandleEntry &entry = entries[handle->mIndex];
+		entry.mKey = 0;
+		++entry.mGeneration;
+		entry.mNextFree = handlefree;
+		handlefree = handle->mIndex;
+
+		handles.Delete(aKey);
+	}
+
+	// release all handles
+	void ClearHandles(void)
+	{
+		std::vector<HandleEntry> &entries = GetHandleEntries();
+		handlefree = ~0U;
+		for (unsigned int index = static_cast<unsigned int>(entries.size()); index-- > 0; )
+		{
+			HandleEntry &entry = entries[index];
+			if (entry.mKey)
+			{
+				entry.mKey = 0;
+				++entry.mGeneration;
+			}
+			entry.mNextFree = handlefree;
+			handlefree = index;
+		}
+		GetHandles().Clear();
+	}
+
+	// get the handle for an instance key
+	// (null handle if the key has none)
+	Handle GetHandle(Key aKey)
+	{
+		const std::vector<HandleEntry> &entries = GetHandleEntries();
+		if (aKey && lastindex < entries.size() && entries[lastindex].mKey == aKey)
+			return Handle(lastindex, entries[lastindex].mGeneration);
+		if (const Handle *handle = GetHandles().FindLocal(aKey))
+		{
+			lastindex = handle->mIndex;
+			return *handle;
+		}
+		return Handle();
+	}
+
+	// get the instance key for a handle
+	// (0 if the handle is stale)
+	Key GetKey(Handle aHandle)
+	{
+		const std::vector<HandleEntry> &entries = GetHandleEntries();
+		if (aHandle.mIndex >= entries.size())
+			return 0;
+		const HandleEntry &entry = entries[aHandle.mIndex];
+		if (entry.mGeneration != aHandle.mGeneration)
+			return 0;
+		return entry.mKey;
+	}
+
+	// is the handle current?
+	bool IsValid(Handle aHandle)
+	{
+		return GetKey(aHandle) != 0;
+	}
+
+	// direct handle index registration
+	HandleIndex::HandleIndex(Untyped &aDatabase)
+	{
+		aDatabase.IndexHandles();
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+namespace Database
+{
+	// generational instance handle
+	// (carried alongside the instance key for direct component indexing)
+	struct Handle
+	{
+		unsigned int mIndex;		// handle table index
+		unsigned int mGeneration;	// handle table generation
+
+		Handle(void)
+			: mIndex(~0U), mGeneration(0)
+		{
+		}
+
+		Handle(unsigned int aIndex, unsigned int aGeneration)
+			: mIndex(aIndex), mGeneration(aGeneration)
+		{
+		}
+
+		bool IsNull(void) const
+		{
+			return mIndex == ~0U;
+		}
+
+		bool operator==(const Handle &aHandle) const
+		{
+			return mIndex == aHandle.mIndex && mGeneration == aHandle.mGeneration;
+		}
+
+		bool operator!=(const Handle &aHandle) const
+		{
+			return mIndex != aHandle.mIndex || mGeneration != aHandle.mGeneration;
+		}
+	};
+}
@@ -0,0 +1,540 @@
+#include "StdAfx.h"
+#include "Journal.h"
+
+// journal format
+static const unsigned int MAGIC = 0x4c4e524a;	// "JRNL"
+static const unsigned int VERSION = 2;
+
+// record tags
+enum RecordTag
+{
+	RECORD_INPUT = 1,
+	RECORD_KEYFRAME = 2,
+	RECORD_DIGEST = 3
+};
+
+// quantized value escape
+// (values that do not survive 16-bit quantization follow as raw floats)
+static const short QUANTIZE_ESCAPE = -32768;
+static const float QUANTIZE_SCALE = 32767.0f;
+
+// write an unsigned variable-length integer
+static void WriteVarint(FILE *aFile, unsigned int aValue)
+{
+	while (aValue >= 0x80)
+	{
+		fputc(int(aValue & 0x7f) | 0x80, aFile);
+		aValue >>= 7;
+	}
+	fputc(int(aValue), aFile);
+}
+
+// read an unsigned variable-length integer
+static bool ReadVarint(FILE *aFile, unsigned int &aValue)
+{
+	aValue = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		const int c = fgetc(aFile);
+		if (c == EOF)
+			return false;
+		aValue |= static_cast<unsigned int>(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// write a value, quantized if that is lossless
+static void WriteValue(FILE *aFile, float aValue)
+{
+	const float scaled = aValue * QUANTIZE_SCALE;
+	if (scaled >= -QUANTIZE_SCALE && scaled <= QUANTIZE_SCALE)
+	{
+		const short quantized = short(xs_RoundToInt(scaled));
+		const float restored = quantized / QUANTIZE_SCALE;
+		if (memcmp(&restored, &aValue, sizeof(float)) == 0)
+		{
+			fwrite(&quantized, sizeof(quantized), 1, aFile);
+			return;
+		}
+	}
+	fwrite(&QUANTIZE_ESCAPE, sizeof(QUANTIZE_ESCAPE), 1, aFile);
+	fwrite(&aValue, sizeof(aValue), 1, aFile);
+}
+
+// read a value
+static bool ReadValue(FILE *aFile, float &aValue)
+{
+	short quantized;
+	if (fread(&quantized, sizeof(quantized), 1, aFile) != 1)
+		return false;
+	if (quantized == QUANTIZE_ESCAPE)
+		return fread(&aValue, sizeof(aValue), 1, aFile) == 1;
+	aValue = quantized / QUANTIZE_SCALE;
+	return true;
+}
+
+// read digest values
+static bool ReadDigest(FILE *aFile, Digest::Values &aValues)
+{
+	unsigned int count;
+	if (!ReadVarint(aFile, count) || count > 0x10000)
+		return false;
+	aValues.resize(count);
+	return count == 0 || fread(&aValues[0], sizeof(Digest::Value), count, aFile) == count;
+}
+
+Journal::Journal(void)
+: mFile(NULL)
+, mRecording(false)
+, mPlaying(false)
+, mTurn(0)
+, mStart(0)
+, mChannels(0)
+, mHasNext(false)
+, mNextTurn(0)
+, mDiverged(false)
+, mDivergedTurn(0)
+, mDocument(NULL)
+, mElement(NULL)
+{
+}
+
+Journal::~Journal(void)
+{
+	Close();
+}
+
+// start recording to a file
+bool Journal::OpenRecord(const char *aFileName)
+{
+	Close();
+
+	mDiverged = false;
+	mFile = fopen(aFileName, "wb");
+	if (!mFile)
+	{
+		DebugPrint("error opening recording file \"%s\"\n", aFileName);
+		return false;
+	}
+
+	// header
+	fwrite(&MAGIC, sizeof(MAGIC), 1, mFile);
+	fwrite(&VERSION, sizeof(VERSION), 1, mFile);
+	mChannels = Input::NUM_LOGICAL;
+	fwrite(&mChannels, sizeof(mChannels), 1, mFile);
+	mStart = sim_turn;
+	fwrite(&mStart, sizeof(mStart), 1, mFile);
+
+	mRecording = true;
+	mTurn = mStart;
+	return true;
+}
+
+// start playing back a file
+bool Journal::OpenPlayback(const char *aFileName)
+{
+	Close();
+
+	mDiverged = false;
+	mFile = fopen(aFileName, "rb");
+	if (!mFile)
+	{
+		DebugPrint("error opening recording file \"%s\"\n", aFileName);
+		return false;
+	}
+
+	// if not a binary journal...
+	unsigned int magic = 0, version = 0;
+	if (fread(&magic, sizeof(magic), 1, mFile) != 1 || magic != MAGIC)
+	{
+		fclose(mFile);
+		mFile = NULL;
+
+		// load it as a legacy XML journal
+		mDocument = new tinyxml2::XMLDocument;
+		if (mDocument->LoadFile(aFileName) != tinyxml2::XML_SUCCESS)
+		{
+			DebugPrint("error loading recording file \"%s\": %s %s\n", aFileName, mDocument->GetErrorStr1(), mDocument->GetErrorStr2());
+			delete mDocument;
+			mDocument = NULL;
+			return false;
+		}
+		const tinyxml2::XMLElement *root = mDocument->RootElement();
+		mElement = root ? root->FirstChildElement() : NULL;
+		mPlaying = true;
+		return true;
+	}
+
+	// header
+	if (fread(&version, sizeof(version), 1, mFile) != 1 || version < 1 || version > VERSION ||
+		fread(&mChannels, sizeof(mChannels), 1, mFile) != 1 || mChannels < 0 ||
+		fread(&mStart, sizeof(mStart), 1, mFile) != 1)
+	{
+		DebugPrint("error loading recording file \"%s\": unsupported journal\n", aFileName);
+		Close();
+		return false;
+	}
+	const long start = ftell(mFile);
+
+	// index keyframes
+	const int maskbytes = (mChannels + 7) / 8;
+	unsigned int turn = mStart;
+	for (;;)
+	{
+		const long offset = ftell(mFile);
+		const int tag = fgetc(mFile);
+		unsigned int delta;
+		if (tag == EOF || !ReadVarint(mFile, delta))
+			break;
+		turn += delta;
+
+		if (tag == RECORD_KEYFRAME)
+		{
+			// skip the input state and snapshot
+			Keyframe keyframe = { turn, offset };
+			mKeyframes.push_back(keyframe);
+			unsigned int size;
+			if (fseek(mFile, long(mChannels * sizeof(float)), SEEK_CUR) != 0 || !ReadVarint(mFile, size) || fseek(mFile, long(size), SEEK_CUR) != 0)
+				break;
+		}
+		else if (tag == RECORD_DIGEST)
+		{
+			// skip the digest values
+			unsigned int count;
+			if (!ReadVarint(mFile, count) || fseek(mFile, long(count * sizeof(Digest::Value)), SEEK_CUR) != 0)
+				break;
+		}
+		else
+		{
+			// skip the changed values
+			unsigned char mask[(Input::NUM_LOGICAL + 7) / 8 + 32];
+			if (maskbytes > int(sizeof(mask)) || fread(mask, 1, maskbytes, mFile) != size_t(maskbytes))
+				break;
+			float value;
+			bool valid = true;
+			for (int i = 0; i < mChannels && valid; ++i)
+				if (mask[i >> 3] & (1 << (i & 7)))
+					valid = ReadValue(mFile, value);
+			if (!valid)
+				break;
+		}
+	}
+
+	// rewind to the first record
+	clearerr(mFile);
+	fseek(mFile, start, SEEK_SET);
+	mTurn = mStart;
+	mPlaying = true;
+	ReadNext();
+	return true;
+}
+
+// finish recording or playback
+void Journal::Close(void)
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = NULL;
+	}
+	delete mDocument;
+	mDocument = NULL;
+	mElement = NULL;
+	mKeyframes.clear();
+	mDigests.clear();
+	mRecording = false;
+	mPlaying = false;
+	mHasNext = false;
+}
+
+// record a keyframe if one is due
+void Journal::RecordKeyframe(unsigned int aTurn, const Input &aInput)
+{
+	if (!mRecording || aTurn % KEYFRAME_INTERVAL != 0)
+		return;
+
+	// save the simulation state
+	Snapshot::Data data;
+	Snapshot::Save(data);
+
+	// write the keyframe record
+	fputc(RECORD_KEYFRAME, mFile);
+	WriteVarint(mFile, aTurn - mTurn);
+	fwrite(aInput.output, sizeof(float), Input::NUM_LOGICAL, mFile);
+	WriteVarint(mFile, static_cast<unsigned int>(data.size()));
+	if (!data.empty())
+		fwrite(&data[0], 1, data.size(), mFile);
+	mTurn = aTurn;
+}
+
+// record the input channels that changed this turn
+void Journal::Record(unsigned int aTurn, const float aPrev[], const Input &aInput)
+{
+	if (!mRecording)
+		return;
+
+	// build the changed-channel mask
+	unsigned char mask[(Input::NUM_LOGICAL + 7) / 8] = { 0 };
+	bool changed = false;
+	for (int i = 0; i < Input::NUM_LOGICAL; ++i)
+	{
+		if (aInput.output[i] != aPrev[i])
+		{
+			mask[i >> 3] |= static_cast<unsigned char>(1 << (i & 7));
+			changed = true;
+		}
+	}
+	if (!changed)
+		return;
+
+	// write the input record
+	fputc(RECORD_INPUT, mFile);
+	WriteVarint(mFile, aTurn - mTurn);
+	fwrite(mask, 1, sizeof(mask), mFile);
+	for (int i = 0; i < Input::NUM_LOGICAL; ++i)
+		if (mask[i >> 3] & (1 << (i & 7)))
+			WriteValue(mFile, aInput.output[i]);
+	mTurn = aTurn;
+}
+
+// record the world state digest for this turn
+void Journal::RecordDigest(unsigned int aTurn)
+{
+	if (!mRecording)
+		return;
+
+	Digest::Values values;
+	Digest::Compute(values);
+
+	// write the digest record
+	fputc(RECORD_DIGEST, mFile);
+	WriteVarint(mFile, aTurn - mTurn);
+	WriteVarint(mFile, static_cast<unsigned int>(values.size()));
+	if (!values.empty())
+		fwrite(&values[0], sizeof(Digest::Value), values.size(), mFile);
+	mTurn = aTurn;
+}
+
+// read the next input record
+void Journal::ReadNext(void)
+{
+	mHasNext = false;
+
+	const int maskbytes = (mChannels + 7) / 8;
+	for (;;)
+	{
+		const int tag = fgetc(mFile);
+		unsigned int delta;
+		if (tag == EOF || !ReadVarint(mFile, delta))
+			return;
+		mTurn += delta;
+
+		if (tag == RECORD_KEYFRAME)
+		{
+			// skip keyframes during playback
+			unsigned int size;
+			if (fseek(mFile, long(mChannels * sizeof(float)), SEEK_CUR) != 0 || !ReadVarint(mFile, size) || fseek(mFile, long(size), SEEK_CUR) != 0)
+				return;
+			continue;
+		}
+
+		if (tag == RECORD_DIGEST)
+		{
+			// hold digests until their turn comes up
+			PendingDigest digest;
+			digest.mTurn = mTurn;
+			if (!ReadDigest(mFile, digest.mValues))
+				return;
+			mDigests.push_back(digest);
+			continue;
+		}
+
+		// read the changed values
+		unsigned char mask[(Input::NUM_LOGICAL + 7) / 8 + 32];
+		if (maskbytes > int(sizeof(mask)) || fread(mask, 1, maskbytes, mFile) != size_t(maskbytes))
+			return;
+		for (int i = 0; i < mChannels; ++i)
+		{
+			float value = 0.0f;
+			const bool changed = (mask[i >> 3] & (1 << (i & 7))) != 0;
+			if (changed && !ReadValue(mFile, value))
+				return;
+			if (i < Input::NUM_LOGICAL)
+			{
+				mNextChanged[i] = changed;
+				mNextOutput[i] = value;
+			}
+		}
+		for (int i = mChannels; i < Input::NUM_LOGICAL; ++i)
+			mNextChanged[i] = false;
+
+		mNextTurn = mTurn;
+		mHasNext = true;
+		return;
+	}
+}
+
+// play back the input for this turn
+bool Journal::Playback(unsigned int aTurn, Input &aInput)
+{
+	if (!mPlaying)
+		return true;
+
+	// legacy XML journal
+	if (mDocument)
+	{
+		// quit if out of turns
+		if (!mElement)
+			return false;
+
+		// if the turn matches the simulation turn...
+		int turn = -1;
+		mElement->QueryIntAttribute("turn", &turn);
+		if ((unsigned int)turn == aTurn)
+		{
+			// update the control values
+			aInput.Playback(mElement);
+
+			// go to the next entry
+			mElement = mElement->NextSiblingElement();
+		}
+		return true;
+	}
+
+	// quit if out of turns
+	if (!mHasNext)
+		return false;
+
+	// if the turn matches the simulation turn...
+	if (mNextTurn == aTurn)
+	{
+		// update the changed control values
+		for (int i = 0; i < Input::NUM_LOGICAL; ++i)
+			if (mNextChanged[i])
+				aInput.output[i] = mNextOutput[i];
+
+		// go to the next record
+		ReadNext();
+	}
+	return true;
+}
+
+// check the world state against the recorded digest for this turn
+void Journal::CheckDigest(unsigned int aTurn)
+{
+	// discard digests for turns that did not get checked
+	while (!mDigests.empty() && mDigests.front().mTurn < aTurn)
+		mDigests.pop_front();
+
+	// done if there is no digest for this turn
+	if (mDigests.empty() || mDigests.front().mTurn != aTurn)
+		return;
+
+	// only the first divergence matters
+	if (!mDiverged)
+	{
+		Digest::Values values;
+		Digest::Compute(values);
+
+		// for each recorded section...
+		const Digest::Values &recorded = mDigests.front().mValues;
+		for (size_t i = 0; i < recorded.size(); ++i)
+		{
+			// find the matching section
+			const Digest::Value *value = NULL;
+			for (size_t j = 0; j < values.size(); ++j)
+			{
+				if (values[j].mSectionId == recorded[i].mSectionId)
+				{
+					value = &values[j];
+					break;
+				}
+			}
+
+			// skip sections that match
+			// (sections added since the recording are not compared)
+			if (value && value->mHash == recorded[i].mHash)
+				continue;
+
+			// report the divergence
+			if (!mDiverged)
+			{
+				DebugPrint("playback diverged at turn %u\n", aTurn);
+				mDiverged = true;
+				mDivergedTurn = aTurn;
+			}
+			const char *name = Digest::GetName(recorded[i].mSectionId);
+			if (name)
+				DebugPrint("  %s differs\n", name);
+			else
+				DebugPrint("  section %08x differs\n", recorded[i].mSectionId);
+		}
+	}
+
+	mDigests.pop_front();
+}
+
+// get the turn of the latest keyframe at or before a turn
+bool Journal::FindKeyframe(unsigned int aTurn, unsigned int &aKeyframeTurn) const
+{
+	for (std::vector<Keyframe>::const_reverse_iterator itor = mKeyframes.rbegin(); itor != mKeyframes.rend(); ++itor)
+	{
+		if (itor->mTurn <= aTurn)
+		{
+			aKeyframeTurn = itor->mTurn;
+			return true;
+		}
+	}
+	return false;
+}
+
+// restore the latest keyframe at or before a turn
+bool Journal::SeekKeyframe(unsigned int aTurn, Input &aInput)
+{
+	if (!mPlaying || !mFile)
+		return false;
+
+	// find the keyframe
+	const Keyframe *keyframe = NULL;
+	for (std::vector<Keyframe>::const_reverse_iterator itor = mKeyframes.rbegin(); itor != mKeyframes.rend(); ++itor)
+	{
+		if (itor->mTurn <= aTurn)
+		{
+			keyframe = &*itor;
+			break;
+		}
+	}
+	if (!keyframe)
+		return false;
+
+	// read the keyframe record
+	clearerr(mFile);
+	fseek(mFile, keyframe->mOffset, SEEK_SET);
+	unsigned int delta, size;
+	float output[Input::NUM_LOGICAL] = { 0 };
+	std::vector<float> channels(mChannels);
+	if (fgetc(mFile) != RECORD_KEYFRAME || !ReadVarint(mFile, delta) ||
+		(mChannels > 0 && fread(&channels[0], sizeof(float), mChannels, mFile) != size_t(mChannels)) ||
+		!ReadVarint(mFile, size))
+		return false;
+	Snapshot::Data data(size);
+	if (size > 0 && fread(&data[0], 1, size, mFile) != size)
+		return false;
+
+	// restore the simulation state
+	if (!Snapshot::Restore(data))
+		return false;
+
+	// restore the input state
+	for (int i = 0; i < mChannels && i < Input::NUM_LOGICAL; ++i)
+		output[i] = channels[i];
+	memcpy(aInput.output, output, sizeof(output));
+
+	// continue playback after the keyframe
+	mDigests.clear();
+	mTurn = keyframe->mTurn;
+	ReadNext();
+	return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Snapshot.h"
+#include "Digest.h"
+
+// input journal
+// (streams the input channels that change each turn to a compact binary file,
+// with periodic simulation keyframes so playback can seek and optional
+// world state digests so playback can detect divergence)
+class GAME_API Journal
+{
+public:
+	// turns between keyframes
+	static const unsigned int KEYFRAME_INTERVAL = 600;
+
+private:
+	// keyframe index entry
+	struct Keyframe
+	{
+		unsigned int mTurn;
+		long mOffset;
+	};
+
+	// recorded digest awaiting its turn
+	struct PendingDigest
+	{
+		unsigned int mTurn;
+		Digest::Values mValues;
+	};
+
+	// journal file
+	FILE *mFile;
+	bool mRecording;
+	bool mPlaying;
+
+	// turn of the last record read or written
+	unsigned int mTurn;
+
+	// turn the journal starts from
+	unsigned int mStart;
+
+	// channels in the file
+	int mChannels;
+
+	// keyframes in the file
+	std::vector<Keyframe> mKeyframes;
+
+	// next input record to play back
+	bool mHasNext;
+	unsigned int mNextTurn;
+	float mNextOutput[Input::NUM_LOGICAL];
+	bool mNextChanged[Input::NUM_LOGICAL];
+
+	// recorded digests read ahead of the simulation
+	std::deque<PendingDigest> mDigests;
+
+	// first turn where playback diverged from the recording
+	bool mDiverged;
+	unsigned int mDivergedTurn;
+
+	// legacy XML journal
+	tinyxml2::XMLDocument *mDocument;
+	const tinyxml2::XMLElement *mElement;
+
+public:
+	Journal(void);
+	~Journal(void);
+
+	// start recording to a file
+	bool OpenRecord(const char *aFileName);
+
+	// start playing back a file
+	// (reads binary journals and legacy XML journals)
+	bool OpenPlayback(const char *aFileName);
+
+	// finish recording or playback
+	void Close(void);
+
+	// is recording or playing back?
+	bool IsRecording(void) const
+	{
+		return mRecording;
+	}
+	bool IsPlaying(void) const
+	{
+		return mPlaying;
+	}
+
+	// has playback diverged from the recording?
+	// (stays set after closing until the next journal opens)
+	bool HasDiverged(void) const
+	{
+		return mDiverged;
+	}
+	unsigned int GetDivergedTurn(void) const
+	{
+		return mDivergedTurn;
+	}
+
+	// record a keyframe if one is due
+	// (call between turns)
+	void RecordKeyframe(unsigned int aTurn, const Input &aInput);
+
+	// record the input channels that changed this turn
+	void Record(unsigned int aTurn, const float aPrev[], const Input &aInput);
+
+	// record the world state digest for this turn
+	// (call after the turn finishes)
+	void RecordDigest(unsigned int aTurn);
+
+	// play back the input for this turn
+	// (returns false when out of turns)
+	bool Playback(unsigned int aTurn, Input &aInput);
+
+	// check the world state against the recorded digest for this turn
+	// (reports the first turn that differs and the sections that differ)
+	void CheckDigest(unsigned int aTurn);
+
+	// get the turn of the latest keyframe at or before a turn
+	// (returns false if there is none)
+	bool FindKeyframe(unsigned int aTurn, unsigned int &aKeyframeTurn) const;
+
+	// restore the latest keyframe at or before a turn
+	// (restores the simulation and input state, and continues playback from there)
+	bool SeekKeyframe(unsigned int aTurn, Input &aInput);
+
+private:
+	// read the next input record
+	void ReadNext(void);
+};
@@ -222,6 +222,10 @@ Link::Link(const LinkTemplate &aTemplate, unsigned int aId)
 		Transform2 transform(aTemplate.mOffset * entity->GetTransform());
 		mSecondary = Database::Instantiate(mSecondary, Database::owner.Get(mId), mId,
 			transform.Angle(), transform.p, entity->GetVelocity(), entity->GetOmega(), false);
+
+		// done if a snapshot restore left it out
+		if (!mSecondary)
+			return;
 	}
 
 	// create a backlink
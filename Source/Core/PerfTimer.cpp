@@ -1,18 +1,39 @@
 #include "StdAfx.h"
 #include "PerfTimer.h"
 
+#if !defined(_MSC_VER)
+#include <chrono>
+#endif
 
-LONGLONG PerfTimer::mFrequency;
+
+long long PerfTimer::mFrequency;
 int PerfTimer::mIndex;
 int PerfTimer::mCount;
 
+// get the current counter value
+// (steady clock nanoseconds where there is no performance counter)
+static long long Counter()
+{
+#if defined(_MSC_VER)
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 
 void PerfTimer::Init()
 {
 	// get frequency
+#if defined(_MSC_VER)
 	LARGE_INTEGER freq;
 	QueryPerformanceFrequency(&freq);
 	mFrequency = freq.QuadPart;
+#else
+	mFrequency = 1000000000;
+#endif
 
 	// reset counters
 	mIndex = NUM_SAMPLES - 1;
@@ -40,22 +61,17 @@ void PerfTimer::Clear()
 
 void PerfTimer::Start()
 {
-	LARGE_INTEGER count;
-	QueryPerformanceCounter(&count);
-	mStamp = count.QuadPart;
+	mStamp = Counter();
 }
 
 void PerfTimer::Stop()
 {
-	LARGE_INTEGER count;
-	QueryPerformanceCounter(&count);
-	mHistory[mIndex] += count.QuadPart - mStamp;
+	mHistory[mIndex] += Counter() - mStamp;
 }
 
 void PerfTimer::Stamp()
 {
-	LARGE_INTEGER count;
-	QueryPerformanceCounter(&count);
-	mHistory[mIndex] = count.QuadPart - mStamp;
-	mStamp = count.QuadPart;
+	const long long count = Counter();
+	mHistory[mIndex] = count - mStamp;
+	mStamp = count;
 }
@@ -4,7 +4,7 @@ class PerfTimer
 {
 public:
 	static const int NUM_SAMPLES = 640;
-	static LONGLONG mFrequency;
+	static long long mFrequency;
 	static int mIndex;
 	static int mCount;
 
@@ -13,8 +13,8 @@ public:
 	static void Next();
 
 public:
-	LONGLONG mHistory[NUM_SAMPLES];
-	LONGLONG mStamp;
+	long long mHistory[NUM_SAMPLES];
+	long long mStamp;
 
 public:
 	PerfTimer();
@@ -26,7 +26,7 @@ public:
 
 	void Stamp();
 
-	LONGLONG Ticks()
+	long long Ticks()
 	{
 		return mHistory[mIndex];
 	}
@@ -0,0 +1,230 @@
+#include "StdAfx.h"
+#include "Profiler.h"
+
+#include <mutex>
+#include <string>
+
+#if defined(_MSC_VER)
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#include <chrono>
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+namespace Profiler
+{
+	// capture in progress
+	std::atomic<bool> gActive(false);
+
+	// timestamp ticks
+	typedef long long Ticks;
+
+	// get the current time in ticks
+	static Ticks Now(void)
+	{
+#if defined(_MSC_VER)
+		LARGE_INTEGER count;
+		QueryPerformanceCounter(&count);
+		return count.QuadPart;
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// get ticks per second
+	static Ticks Frequency(void)
+	{
+#if defined(_MSC_VER)
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		return freq.QuadPart;
+#else
+		return 1000000000;
+#endif
+	}
+
+	// completed zone
+	struct Event
+	{
+		const char *mName;
+		Ticks mStart;
+		Ticks mEnd;
+		int mDepth;
+	};
+
+	// open zone
+	struct Open
+	{
+		const char *mName;
+		Ticks mStart;
+	};
+
+	// per-thread zone buffer
+	// (control workers record zones only inside Worker::Run, which returns
+	// once they check in, so their buffers are at rest when Turn writes or
+	// clears them; threads outside the turn, like the audio thread, record
+	// asynchronous zones that take the buffer lock)
+	struct Buffer
+	{
+		int mThread;
+		std::mutex mMutex;
+		std::vector<Open> mOpen;
+		std::vector<Event> mEvents;
+	};
+
+	// all thread buffers
+	// (buffers live until exit since threads keep pointers to them)
+	static std::mutex sMutex;
+	static std::vector<Buffer *> sBuffers;
+
+	// this thread's buffer
+	static PROFILER_THREAD_LOCAL Buffer *tBuffer;
+
+	// capture window
+	static int sPending;
+	static int sRemaining;
+	static std::string sFileName;
+	static Ticks sOrigin;
+
+	// get this thread's buffer
+	static Buffer &GetBuffer(void)
+	{
+		if (!tBuffer)
+		{
+			std::lock_guard<std::mutex> lock(sMutex);
+			tBuffer = new Buffer;
+			tBuffer->mThread = int(sBuffers.size()) + 1;
+			sBuffers.push_back(tBuffer);
+		}
+		return *tBuffer;
+	}
+
+	// open a zone
+	void Begin(const char *aName)
+	{
+		Buffer &buffer = GetBuffer();
+		Open open = { aName, Now() };
+		buffer.mOpen.push_back(open);
+	}
+
+	// record the innermost open zone as completed
+	static void Close(Buffer &aBuffer, Ticks aEnd)
+	{
+		// skip zones opened before the buffer was cleared
+		if (aBuffer.mOpen.empty())
+			return;
+
+		const Open &open = aBuffer.mOpen.back();
+		Event event = { open.mName, open.mStart, aEnd, int(aBuffer.mOpen.size()) - 1 };
+		aBuffer.mEvents.push_back(event);
+		aBuffer.mOpen.pop_back();
+	}
+
+	// close a zone
+	void End(void)
+	{
+		const Ticks end = Now();
+		Close(GetBuffer(), end);
+	}
+
+	// open a zone on a thread outside the turn
+	void BeginAsync(const char *aName)
+	{
+		Buffer &buffer = GetBuffer();
+		Open open = { aName, Now() };
+		std::lock_guard<std::mutex> lock(buffer.mMutex);
+		buffer.mOpen.push_back(open);
+	}
+
+	// close a zone on a thread outside the turn
+	void EndAsync(void)
+	{
+		const Ticks end = Now();
+		Buffer &buffer = GetBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mMutex);
+		Close(buffer, end);
+	}
+
+	// write a zone name as a JSON string
+	static void WriteName(FILE *aFile, const char *aName)
+	{
+		fputc('"', aFile);
+		for (const char *c = aName; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', aFile);
+			fputc(*c, aFile);
+		}
+		fputc('"', aFile);
+	}
+
+	// write the captured zones as a Chrome trace
+	static void Write(void)
+	{
+		FILE *file = fopen(sFileName.c_str(), "w");
+		if (!file)
+		{
+			DebugPrint("profile: error writing \"%s\"\n", sFileName.c_str());
+			return;
+		}
+
+		const double scale = 1000000.0 / double(Frequency());
+		size_t count = 0;
+
+		fputs("{\"traceEvents\":[\n", file);
+		std::lock_guard<std::mutex> lock(sMutex);
+		for (size_t i = 0; i < sBuffers.size(); ++i)
+		{
+			Buffer &buffer = *sBuffers[i];
+			std::lock_guard<std::mutex> bufferlock(buffer.mMutex);
+			for (size_t j = 0; j < buffer.mEvents.size(); ++j)
+			{
+				const Event &event = buffer.mEvents[j];
+				fputs(count ? ",\n{\"name\":" : "{\"name\":", file);
+				WriteName(file, event.mName);
+				fprintf(file, ",\"cat\":\"game\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"depth\":%d}}",
+					scale * double(event.mStart - sOrigin), scale * double(event.mEnd - event.mStart), buffer.mThread, event.mDepth);
+				++count;
+			}
+			buffer.mEvents.clear();
+		}
+		fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+		fclose(file);
+
+		DebugPrint("profile: wrote %u zones to \"%s\"\n", unsigned(count), sFileName.c_str());
+	}
+
+	// capture the next turns
+	void Capture(int aTurns, const char *aFileName)
+	{
+		sPending = aTurns;
+		sFileName = aFileName;
+	}
+
+	// advance to the next turn
+	void Turn(void)
+	{
+		// finish a capture that has run its turns
+		if (gActive && --sRemaining <= 0)
+		{
+			gActive = false;
+			Write();
+		}
+
+		// start a pending capture
+		if (sPending > 0)
+		{
+			std::lock_guard<std::mutex> lock(sMutex);
+			for (size_t i = 0; i < sBuffers.size(); ++i)
+			{
+				std::lock_guard<std::mutex> bufferlock(sBuffers[i]->mMutex);
+				sBuffers[i]->mOpen.clear();
+				sBuffers[i]->mEvents.clear();
+			}
+			sRemaining = sPending;
+			sPending = 0;
+			sOrigin = Now();
+			gActive = true;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+
+// compile in profiler zones
+// (comment out to compile them away entirely)
+#define ENABLE_PROFILER
+
+// hierarchical zone profiler
+// (zones nest by scope on each thread; captures cover a window of turns
+// and write a Chrome trace_event file for chrome://tracing)
+namespace Profiler
+{
+	// capture in progress
+	// (zones cost one test of this flag when nothing is capturing)
+	extern GAME_API std::atomic<bool> gActive;
+
+	// open and close a zone on the current thread
+	// (the name must outlive the capture, e.g. a string literal)
+	GAME_API void Begin(const char *aName);
+	GAME_API void End(void);
+
+	// open and close a zone on a thread that runs outside the turn
+	// (such as the audio thread; these lock the thread's buffer since the
+	// main thread may write or clear it at any time, so a thread must not
+	// mix them with Begin and End)
+	GAME_API void BeginAsync(const char *aName);
+	GAME_API void EndAsync(void);
+
+	// capture the next turns and write them to a file
+	GAME_API void Capture(int aTurns, const char *aFileName);
+
+	// advance to the next turn
+	// (starts a pending capture and finishes one that has run its turns)
+	GAME_API void Turn(void);
+
+	// scoped zone
+	class Zone
+	{
+	private:
+		bool mActive;
+
+	public:
+		Zone(const char *aName)
+			: mActive(gActive.load(std::memory_order_relaxed))
+		{
+			if (mActive)
+				Begin(aName);
+		}
+
+		~Zone()
+		{
+			if (mActive)
+				End();
+		}
+	};
+
+	// scoped zone on a thread outside the turn
+	class AsyncZone
+	{
+	private:
+		bool mActive;
+
+	public:
+		AsyncZone(const char *aName)
+			: mActive(gActive.load(std::memory_order_relaxed))
+		{
+			if (mActive)
+				BeginAsync(aName);
+		}
+
+		~AsyncZone()
+		{
+			if (mActive)
+				EndAsync();
+		}
+	};
+}
+
+// profile the rest of the enclosing scope
+#ifdef ENABLE_PROFILER
+#define PROFILE_ZONE_CONCAT2(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_ZONE_CONCAT(profilezone, __LINE__)(name)
+#define PROFILE_ZONE_ASYNC(name) Profiler::AsyncZone PROFILE_ZONE_CONCAT(profilezone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_ASYNC(name)
+#endif
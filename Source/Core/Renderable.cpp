@@ -2,6 +2,7 @@
 #include "Renderable.h"
 #include "Drawlist.h"
 #include "Entity.h"
+#include "Profiler.h"
 
 #ifdef USE_POOL_ALLOCATOR
 // renderable pool
@@ -21,6 +22,7 @@ namespace Database
 {
 	Typed<RenderableTemplate> renderabletemplate(0x0cb54133 /* "renderabletemplate" */);
 	Typed<Renderable *> renderable(0x109dd1ad /* "renderable" */);
+	HandleIndex renderablehandleindex(renderable);
 
 	namespace Loader
 	{
@@ -109,33 +111,51 @@ bool RenderableTemplate::Configure(const tinyxml2::XMLElement *element, unsigned
 }
 
 
-Renderable *Renderable::sHead;
-Renderable *Renderable::sTail;
+std::vector<Renderable::Bucket *> Renderable::sBuckets;
+std::vector<Renderable *> Renderable::sLoose;
+unsigned int Renderable::sCount;
+unsigned int Renderable::sOrder;
+unsigned int Renderable::sPass;
+Renderable::Stats Renderable::sStats;
 
 Renderable::Renderable(void)
 : mId(0)
+, mHandle()
+, mBucket(NULL)
 , mNext(NULL)
 , mPrev(NULL)
 , mActive(false)
 , mAction()
 , mRadius(0)
 , mDepth(0)
+, mLoose(~0U)
+, mOrder(0)
+, mVisit(0)
 , mStart(sim_turn)
 , mFraction(sim_fraction)
 {
+	mCells.mX0 = mCells.mY0 = 1;
+	mCells.mX1 = mCells.mY1 = 0;
 }
 
 Renderable::Renderable(const RenderableTemplate &aTemplate, unsigned int aId)
 : mId(aId)
+, mHandle(Database::GetHandle(aId))
+, mBucket(NULL)
 , mNext(NULL)
 , mPrev(NULL)
 , mActive(false)
 , mAction()
 , mRadius(aTemplate.mRadius)
 , mDepth(aTemplate.mDepth)
+, mLoose(~0U)
+, mOrder(0)
+, mVisit(0)
 , mStart(sim_turn)
 , mFraction(sim_fraction)
 {
+	mCells.mX0 = mCells.mY0 = 1;
+	mCells.mX1 = mCells.mY1 = 0;
 }
 
 Renderable::~Renderable(void)
@@ -143,55 +163,70 @@ Renderable::~Renderable(void)
 	Hide();
 }
 
+// find or add the bucket for a depth
+Renderable::Bucket *Renderable::FindBucket(float aDepth)
+{
+	// binary search for the first bucket not drawn before the depth
+	size_t lo = 0, hi = sBuckets.size();
+	while (lo < hi)
+	{
+		const size_t mid = (lo + hi) / 2;
+#ifdef DRAW_FRONT_TO_BACK
+		if (sBuckets[mid]->mDepth < aDepth)
+#else
+		if (sBuckets[mid]->mDepth > aDepth)
+#endif
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// use the bucket if it has the same depth
+	if (lo < sBuckets.size() && sBuckets[lo]->mDepth == aDepth)
+		return sBuckets[lo];
+
+	// add a bucket for the new depth
+	Bucket *bucket = new Bucket;
+	bucket->mDepth = aDepth;
+	bucket->mHead = NULL;
+	bucket->mTail = NULL;
+	sBuckets.insert(sBuckets.begin() + lo, bucket);
+	return bucket;
+}
+
 void Renderable::Show(void)
 {
 	if (!mActive)
 	{
-		Renderable *aParent;
+		mBucket = FindBucket(mDepth);
 
 #ifdef DRAW_FRONT_TO_BACK
-		// TO DO: make this go faster
-		for (aParent = sHead; aParent != NULL; aParent = aParent->mNext)
-			if (mDepth <= aParent->mDepth)
-				break;
-
-		if (aParent)
-		{
-			mNext = aParent;
-			mPrev = aParent->mPrev;
-		}
-		else
-		{
-			mNext = NULL;
-			mPrev = sTail;
-		}
+		// add to the front of the bucket
+		mNext = mBucket->mHead;
+		mPrev = NULL;
 #else
-		// TO DO: make this go faster
-		for (aParent = sTail; aParent != NULL; aParent = aParent->mPrev)
-			if (mDepth <= aParent->mDepth)
-				break;
-
-		if (aParent)
-		{
-			mNext = aParent->mNext;
-			mPrev = aParent;
-		}
-		else
-		{
-			mNext = sHead;
-			mPrev = NULL;
-		}
+		// add to the back of the bucket
+		mNext = NULL;
+		mPrev = mBucket->mTail;
 #endif
 
 		if (mNext)
 			mNext->mPrev = this;
 		else
-			sTail = this;
+			mBucket->mTail = this;
 		if (mPrev)
 			mPrev->mNext = this;
 		else
-			sHead = this;
+			mBucket->mHead = this;
 		mActive = true;
+		mOrder = sOrder++;
+		++sCount;
+
+		// get the instance handle if set up without one
+		if (!Database::IsValid(mHandle))
+			mHandle = Database::GetHandle(mId);
+
+		Register();
 	}
 }
 
@@ -199,46 +234,276 @@ void Renderable::Hide(void)
 {
 	if (mActive)
 	{
-		if (sHead == this)
-			sHead = mNext;
-		if (sTail == this)
-			sTail = mPrev;
+		if (mBucket->mHead == this)
+			mBucket->mHead = mNext;
+		if (mBucket->mTail == this)
+			mBucket->mTail = mPrev;
 		if (mNext)
 			mNext->mPrev = mPrev;
 		if (mPrev)
 			mPrev->mNext = mNext;
+		Unregister();
+		--sCount;
+		mBucket = NULL;
 		mNext = NULL;
 		mPrev = NULL;
 		mActive = false;
 	}
 }
 
+// grid cell size in world units
+static const float GRID_CELL_SIZE = 64.0f;
+
+// grid cell index limit along each axis
+// (anything farther out shares the outermost cells)
+static const int GRID_LIMIT = 32767;
+
+// maximum cells a renderable registers in
+// (larger renderables get checked by every render)
+static const int GRID_MAX_SPAN = 16;
+
+// maximum view cells to visit
+// (larger views draw every shown renderable instead)
+static const int GRID_MAX_VIEW = 4096;
+
+// shown renderables by grid cell
+// (sparse, so only occupied cells take space)
+static Database::Typed<std::vector<Renderable *> > sCells;
+
+// scratch space for rendering
+static std::vector<Renderable *> sVisible;
+
+// get the bounds of a renderable over the render step
+// (the interpolated position lies between the previous and current positions)
+static inline void GetEntityBounds(const Entity *aEntity, float aRadius, AlignedBox2 &aBox)
+{
+	const Vector2 &p0 = aEntity->GetPrevPosition();
+	const Vector2 &p1 = aEntity->GetPosition();
+	aBox.min.x = std::min(p0.x, p1.x) - aRadius;
+	aBox.min.y = std::min(p0.y, p1.y) - aRadius;
+	aBox.max.x = std::max(p0.x, p1.x) + aRadius;
+	aBox.max.y = std::max(p0.y, p1.y) + aRadius;
+}
+
+// get a cell index along an axis
+// (clamped to the limit, with anything not finite going to the lowest cell)
+static inline int GetCellIndex(float aValue)
+{
+	const float cell = floorf(aValue * (1.0f / GRID_CELL_SIZE));
+	if (!(cell > float(-GRID_LIMIT)))
+		return -GRID_LIMIT;
+	if (cell >= float(GRID_LIMIT))
+		return GRID_LIMIT;
+	return int(cell);
+}
+
+// get the key for a grid cell
+// (never zero, since indices stay above the lowest 16-bit value)
+static inline unsigned int GetCellKey(int aX, int aY)
+{
+	return (static_cast<unsigned int>(aY + 32768) << 16) | static_cast<unsigned int>(aX + 32768);
+}
+
+// get the grid cells covering the renderable
+bool Renderable::GetCells(const Entity *aEntity, CellRange &aCells) const
+{
+	AlignedBox2 box;
+	GetEntityBounds(aEntity, mRadius, box);
+	aCells.mX0 = GetCellIndex(box.min.x);
+	aCells.mY0 = GetCellIndex(box.min.y);
+	aCells.mX1 = GetCellIndex(box.max.x);
+	aCells.mY1 = GetCellIndex(box.max.y);
+	const int width = aCells.mX1 - aCells.mX0 + 1;
+	const int height = aCells.mY1 - aCells.mY0 + 1;
+	return width <= GRID_MAX_SPAN && height <= GRID_MAX_SPAN && width * height <= GRID_MAX_SPAN;
+}
+
+// register with the grid
+void Renderable::Register(void)
+{
+	// renderables with a tracked entity register in the cells they cover
+	// (anything else gets checked by every render)
+	const Entity *entity = Database::entity.Get(mHandle);
+	if (entity && Database::renderable.Get(mHandle) == this && GetCells(entity, mCells))
+	{
+		for (int y = mCells.mY0; y <= mCells.mY1; ++y)
+		{
+			for (int x = mCells.mX0; x <= mCells.mX1; ++x)
+			{
+				const unsigned int key = GetCellKey(x, y);
+				sCells.Open(key).push_back(this);
+				sCells.Close(key);
+			}
+		}
+	}
+	else
+	{
+		mCells.mX0 = mCells.mY0 = 1;
+		mCells.mX1 = mCells.mY1 = 0;
+		mLoose = static_cast<unsigned int>(sLoose.size());
+		sLoose.push_back(this);
+	}
+}
+
+// unregister from the grid
+void Renderable::Unregister(void)
+{
+	if (mLoose != ~0U)
+	{
+		Renderable *last = sLoose.back();
+		sLoose[mLoose] = last;
+		last->mLoose = mLoose;
+		sLoose.pop_back();
+		mLoose = ~0U;
+		return;
+	}
+
+	for (int y = mCells.mY0; y <= mCells.mY1; ++y)
+	{
+		for (int x = mCells.mX0; x <= mCells.mX1; ++x)
+		{
+			const unsigned int key = GetCellKey(x, y);
+			std::vector<Renderable *> &cell = sCells.Open(key);
+			std::vector<Renderable *>::iterator itor = std::find(cell.begin(), cell.end(), this);
+			assert(itor != cell.end());
+			*itor = cell.back();
+			cell.pop_back();
+			const bool empty = cell.empty();
+			sCells.Close(key);
+			if (empty)
+				sCells.Delete(key);
+		}
+	}
+	mCells.mX0 = mCells.mY0 = 1;
+	mCells.mX1 = mCells.mY1 = 0;
+}
+
+// update grid registration for moved entities
+void Renderable::UpdateGrid(void)
+{
+	const std::vector<Entity *> &moved = Entity::GetMoved();
+	for (std::vector<Entity *>::const_iterator itor = moved.begin(); itor != moved.end(); ++itor)
+	{
+		const Entity *entity = *itor;
+		Renderable *renderable = Database::renderable.Get(entity->GetId());
+		if (!renderable || !renderable->mActive)
+			continue;
+
+		// skip if the registration still holds
+		CellRange cells;
+		if (renderable->GetCells(entity, cells))
+		{
+			if (renderable->mLoose == ~0U &&
+				cells.mX0 == renderable->mCells.mX0 && cells.mY0 == renderable->mCells.mY0 &&
+				cells.mX1 == renderable->mCells.mX1 && cells.mY1 == renderable->mCells.mY1)
+				continue;
+		}
+		else
+		{
+			if (renderable->mLoose != ~0U)
+				continue;
+		}
+
+		// move to the new cells
+		renderable->Unregister();
+		renderable->Register();
+	}
+	Entity::ClearMoved();
+}
+
+// drawing order comparison
+// (by bucket, then by position within the bucket)
+bool Renderable::DrawOrder(const Renderable *aA, const Renderable *aB)
+{
+	if (aA->mBucket != aB->mBucket)
+#ifdef DRAW_FRONT_TO_BACK
+		return aA->mBucket->mDepth < aB->mBucket->mDepth;
+	return aA->mOrder > aB->mOrder;
+#else
+		return aA->mBucket->mDepth > aB->mBucket->mDepth;
+	return aA->mOrder < aB->mOrder;
+#endif
+}
+
 void Renderable::RenderAll(const AlignedBox2 &aView)
 {
+	PROFILE_ZONE("Renderable::RenderAll");
+
 	// render matrix
 	float angle;
 	Vector2 position;
 
-#ifdef RENDER_STATS
-	// stats
-	int drawn = 0, culled = 0;
-#endif
+	// move renderables whose entities moved to their new cells
+	UpdateGrid();
 
-	// render all renderables
-	Renderable *itor = sHead;
-	while (itor)
+	sStats.mShown = sCount;
+	sStats.mCells = 0;
+	sStats.mCandidates = 0;
+	sStats.mDrawn = 0;
+
+	// start a new gathering pass
+	if (++sPass == 0)
 	{
-		// get the next iterator
-		// (in case the entry gets deleted)
-		Renderable *next = itor->mNext;
+		for (std::vector<Bucket *>::const_iterator bucket = sBuckets.begin(); bucket != sBuckets.end(); ++bucket)
+			for (Renderable *itor = (*bucket)->mHead; itor != NULL; itor = itor->mNext)
+				itor->mVisit = 0;
+		sPass = 1;
+	}
+
+	sVisible.clear();
+	const int x0 = GetCellIndex(aView.min.x);
+	const int y0 = GetCellIndex(aView.min.y);
+	const int x1 = GetCellIndex(aView.max.x);
+	const int y1 = GetCellIndex(aView.max.y);
+	const int width = x1 - x0 + 1;
+	const int height = y1 - y0 + 1;
+	if (width <= GRID_MAX_VIEW && height <= GRID_MAX_VIEW && width * height <= GRID_MAX_VIEW)
+	{
+		// gather renderables registered in the cells overlapping the view
+		// (a renderable registered in several cells gets gathered once)
+		sStats.mCells = width * height;
+		for (int y = y0; y <= y1; ++y)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				if (const std::vector<Renderable *> *cell = sCells.Find(GetCellKey(x, y)))
+				{
+					for (std::vector<Renderable *>::const_iterator itor = cell->begin(); itor != cell->end(); ++itor)
+					{
+						if ((*itor)->mVisit != sPass)
+						{
+							(*itor)->mVisit = sPass;
+							sVisible.push_back(*itor);
+						}
+					}
+				}
+			}
+		}
+
+		// loose renderables are always candidates
+		sVisible.insert(sVisible.end(), sLoose.begin(), sLoose.end());
+
+		// restore drawing order
+		std::sort(sVisible.begin(), sVisible.end(), DrawOrder);
+	}
+	else
+	{
+		// every shown renderable is a candidate
+		for (std::vector<Bucket *>::const_iterator bucket = sBuckets.begin(); bucket != sBuckets.end(); ++bucket)
+			for (Renderable *itor = (*bucket)->mHead; itor != NULL; itor = itor->mNext)
+				sVisible.push_back(itor);
+	}
+	sStats.mCandidates = static_cast<unsigned int>(sVisible.size());
+
+	// render the candidates
+	for (std::vector<Renderable *>::const_iterator candidate = sVisible.begin(); candidate != sVisible.end(); ++candidate)
+	{
+		const Renderable *itor = *candidate;
 
 		// get the entity (HACK)
-		const Entity *entity = Database::entity.Get(itor->mId);
+		const Entity *entity = Database::entity.Get(itor->mHandle);
 		if (!entity)
-		{
-			itor = next;
 			continue;
-		}
 
 #ifdef RENDER_SIMULATION_POSITIONS
 		// draw line between last and current simulated position
@@ -270,22 +535,7 @@ void Renderable::RenderAll(const AlignedBox2 &aView)
 			// render
 			(itor->mAction)(itor->mId, t, renderable.mTransform ? Transform2(angle, position) : Transform2::Identity());
 
-#ifdef RENDER_STATS
-			++drawn;
-#endif
+			++sStats.mDrawn;
 		}
-#ifdef RENDER_STATS
-		else
-		{
-			++culled;
-		}
-#endif
-
-		// go to the next iterator
-		itor = next;
 	}
-
-#ifdef RENDER_STATS
-	DebugPrint("d=%d/%d\n", drawn, drawn+culled);
-#endif
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+class Entity;
+
 class GAME_API RenderableTemplate
 {
 public:
@@ -28,16 +30,62 @@ class GAME_API Renderable
 public:
 	typedef fastdelegate::FastDelegate<void (unsigned int, float, const Transform2 &)> Action;
 
+	// render statistics for the last render
+	struct Stats
+	{
+		unsigned int mShown;		// renderables shown
+		unsigned int mCells;		// grid cells overlapping the view
+		unsigned int mCandidates;	// renderables registered in those cells
+		unsigned int mDrawn;		// renderables inside the view
+	};
+
 protected:
 	// identifier
 	unsigned int mId;
 
+	// instance handle
+	Database::Handle mHandle;
+
 private:
-	// list of all renderables
-	static Renderable *sHead;
-	static Renderable *sTail;
+	// depth bucket
+	// (renderables sharing a sorting depth, linked in drawing order)
+	struct Bucket
+	{
+		float mDepth;
+		Renderable *mHead;
+		Renderable *mTail;
+	};
+
+	// depth buckets in drawing order
+	// (one per distinct depth, kept for reuse once empty)
+	static std::vector<Bucket *> sBuckets;
+
+	// range of grid cells
+	// (empty when the minimum exceeds the maximum)
+	struct CellRange
+	{
+		int mX0, mY0;
+		int mX1, mY1;
+	};
+
+	// shown renderables not registered in grid cells
+	// (too large, or not tracked through entity movement)
+	static std::vector<Renderable *> sLoose;
+
+	// number of shown renderables
+	static unsigned int sCount;
+
+	// show order, for drawing order within a bucket
+	static unsigned int sOrder;
+
+	// render pass, for gathering each renderable once
+	static unsigned int sPass;
 
-	// linked list
+	// render statistics
+	static Stats sStats;
+
+	// linked list within the depth bucket
+	Bucket *mBucket;
 	Renderable *mNext;
 	Renderable *mPrev;
 	bool mActive;
@@ -51,6 +99,29 @@ private:
 	// sorting depth
 	float mDepth;
 
+	// grid registration
+	CellRange mCells;
+	unsigned int mLoose;
+	unsigned int mOrder;
+	unsigned int mVisit;
+
+	// find or add the bucket for a depth
+	static Bucket *FindBucket(float aDepth);
+
+	// get the grid cells covering the renderable
+	// (returns false if there are too many to register in)
+	bool GetCells(const Entity *aEntity, CellRange &aCells) const;
+
+	// register with the grid
+	void Register(void);
+	void Unregister(void);
+
+	// update grid registration for moved entities
+	static void UpdateGrid(void);
+
+	// drawing order comparison
+	static bool DrawOrder(const Renderable *aA, const Renderable *aB);
+
 protected:
 	// creation turn
 	unsigned int mStart;
@@ -87,8 +158,14 @@ public:
 		return mFraction;
 	}
 
-	// render
+	// render all renderables
 	static void RenderAll(const AlignedBox2 &aView);
+
+	// get render statistics for the last render
+	static const Stats &GetStats(void)
+	{
+		return sStats;
+	}
 };
 
 // render geometry
@@ -2,6 +2,206 @@
 
 #include "DatabaseTyped.h"
 
+// signal connection list
+// (a few slots stored inline, spilling to the heap; emitting does not allocate;
+// slots run in connection order, where they used to run in the hash order of
+// their delegates, so a signal with more than one slot such as deathsignal,
+// killsignal, or collidablecontactadd runs them in a different order than
+// before and journals recorded under the old order do not play back the same)
+template <typename Slot> class SignalConnections
+{
+private:
+	static const size_t INLINE = 2;
+
+	// connection entry
+	// (a slot disconnected during an emit stays until the emit finishes,
+	// so connecting it again before then reuses the entry)
+	struct Entry
+	{
+		Slot mSlot;
+		bool mConnected;
+	};
+
+	Entry mInline[INLINE];		// inline entries
+	Entry *mHeap;				// heap entries (replaces the inline entries when full)
+	unsigned short mCount;		// number of entries
+	unsigned short mLimit;		// entry capacity
+	mutable unsigned short mEmitting;	// number of emits in progress
+	mutable bool mRemoved;		// entries disconnected during an emit
+
+	Entry *GetEntries(void)
+	{
+		return mHeap ? mHeap : mInline;
+	}
+	const Entry *GetEntries(void) const
+	{
+		return mHeap ? mHeap : mInline;
+	}
+
+	// remove entries disconnected during an emit
+	// (keeps the remaining entries in connection order)
+	void Compact(void)
+	{
+		Entry *entries = GetEntries();
+		unsigned short count = 0;
+		for (unsigned short i = 0; i < mCount; ++i)
+		{
+			if (entries[i].mConnected)
+				entries[count++] = entries[i];
+		}
+		mCount = count;
+		mRemoved = false;
+	}
+
+	void Assign(const SignalConnections &aSource)
+	{
+		if (aSource.mCount > INLINE)
+		{
+			mHeap = new Entry[aSource.mCount];
+			mLimit = aSource.mCount;
+		}
+		const Entry *source = aSource.GetEntries();
+		Entry *entries = GetEntries();
+		mCount = 0;
+		for (unsigned short i = 0; i < aSource.mCount; ++i)
+		{
+			if (source[i].mConnected)
+				entries[mCount++] = source[i];
+		}
+	}
+
+public:
+	SignalConnections()
+		: mHeap(NULL), mCount(0), mLimit(INLINE), mEmitting(0), mRemoved(false)
+	{
+	}
+	SignalConnections(const SignalConnections &aSource)
+		: mHeap(NULL), mCount(0), mLimit(INLINE), mEmitting(0), mRemoved(false)
+	{
+		Assign(aSource);
+	}
+	~SignalConnections()
+	{
+		delete[] mHeap;
+	}
+
+	SignalConnections &operator=(const SignalConnections &aSource)
+	{
+		if (this != &aSource)
+		{
+			delete[] mHeap;
+			mHeap = NULL;
+			mLimit = INLINE;
+			Assign(aSource);
+		}
+		return *this;
+	}
+
+	// connect a slot
+	// (connecting a slot again has no effect; reconnecting a slot disconnected
+	// during the current emit puts it back in its old place, so it does not run
+	// a second time if it already ran)
+	void Connect(const Slot &aSlot)
+	{
+		Entry *entries = GetEntries();
+		for (unsigned short i = 0; i < mCount; ++i)
+		{
+			if (entries[i].mSlot == aSlot)
+			{
+				entries[i].mConnected = true;
+				return;
+			}
+		}
+		if (mCount >= mLimit)
+		{
+			// spill to a larger heap array
+			const unsigned short limit = mLimit * 2;
+			Entry *heap = new Entry[limit];
+			for (unsigned short i = 0; i < mCount; ++i)
+				heap[i] = entries[i];
+			delete[] mHeap;
+			mHeap = heap;
+			mLimit = limit;
+			entries = heap;
+		}
+		entries[mCount].mSlot = aSlot;
+		entries[mCount].mConnected = true;
+		++mCount;
+	}
+
+	// disconnect a slot
+	// (during an emit, the entry is kept and removed when the emit finishes)
+	void Disconnect(const Slot &aSlot)
+	{
+		Entry *entries = GetEntries();
+		for (unsigned short i = 0; i < mCount; ++i)
+		{
+			if (entries[i].mConnected && entries[i].mSlot == aSlot)
+			{
+				entries[i].mConnected = false;
+				if (mEmitting)
+					mRemoved = true;
+				else
+					Compact();
+				return;
+			}
+		}
+	}
+
+	size_t GetCount(void) const
+	{
+		return mCount;
+	}
+
+	// slot iterator
+	// (slots connected during an emit are included; slots disconnected are skipped)
+	class Iterator
+	{
+	private:
+		const SignalConnections *mConnections;
+		unsigned short mIndex;
+
+		void Skip(void)
+		{
+			const Entry *entries = mConnections->GetEntries();
+			while (mIndex < mConnections->mCount && !entries[mIndex].mConnected)
+				++mIndex;
+		}
+
+	public:
+		Iterator(const SignalConnections *aConnections)
+			: mConnections(aConnections), mIndex(0)
+		{
+			++mConnections->mEmitting;
+			Skip();
+		}
+		~Iterator()
+		{
+			if (--mConnections->mEmitting == 0 && mConnections->mRemoved)
+				const_cast<SignalConnections *>(mConnections)->Compact();
+		}
+
+		bool IsValid(void) const
+		{
+			return mIndex < mConnections->mCount;
+		}
+
+		// get the current slot
+		// (by value, since a slot may connect another and move the array)
+		Slot GetValue(void) const
+		{
+			return mConnections->GetEntries()[mIndex].mSlot;
+		}
+
+		Iterator &operator++(void)
+		{
+			++mIndex;
+			Skip();
+			return *this;
+		}
+	};
+};
+
 template<typename Signature> class Signal;
 
 template <typename R> class Signal<R()>
@@ -10,7 +210,7 @@ public:
 	typedef fastdelegate::FastDelegate<R()> Slot;
 
 private:
-	typedef Database::Typed<Slot> Connections;
+	typedef SignalConnections<Slot> Connections;
 	Connections mConnections;
 
 public:
@@ -19,7 +219,7 @@ public:
 
 	void Connect(const Slot &aSlot)
 	{
-		mConnections.Put(Hash(&aSlot, sizeof(Slot)), aSlot);
+		mConnections.Connect(aSlot);
 	}
 	template <typename H, typename F> void Connect(H aHolder, F aFunc)
 	{
@@ -28,7 +228,7 @@ public:
 
 	void Disconnect(const Slot &aSlot)
 	{
-		mConnections.Delete(Hash(&aSlot, sizeof(Slot)));
+		mConnections.Disconnect(aSlot);
 	}
 	template <typename H, typename F> void Disconnect(H aHolder, F aFunc)
 	{
@@ -37,7 +237,7 @@ public:
 
 	void operator()(void) const
 	{
-		for (Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
+		for (typename Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
 			itor.GetValue()();
 	}
 };
@@ -48,7 +248,7 @@ public:
 	typedef fastdelegate::FastDelegate<R(A1)> Slot;
 
 private:
-	typedef Database::Typed<Slot> Connections;
+	typedef SignalConnections<Slot> Connections;
 	Connections mConnections;
 
 public:
@@ -57,7 +257,7 @@ public:
 
 	void Connect(const Slot &aSlot)
 	{
-		mConnections.Put(Hash(&aSlot, sizeof(Slot)), aSlot);
+		mConnections.Connect(aSlot);
 	}
 	template <typename H, typename F> void Connect(H aHolder, F aFunc)
 	{
@@ -66,7 +266,7 @@ public:
 
 	void Disconnect(const Slot &aSlot)
 	{
-		mConnections.Delete(Hash(&aSlot, sizeof(Slot)));
+		mConnections.Disconnect(aSlot);
 	}
 	template <typename H, typename F> void Disconnect(H aHolder, F aFunc)
 	{
@@ -75,7 +275,7 @@ public:
 
 	void operator()(A1 aArg1) const
 	{
-		for (Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
+		for (typename Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
 			itor.GetValue()(aArg1);
 	}
 };
@@ -86,7 +286,7 @@ public:
 	typedef fastdelegate::FastDelegate<R(A1, A2)> Slot;
 
 private:
-	typedef Database::Typed<Slot> Connections;
+	typedef SignalConnections<Slot> Connections;
 	Connections mConnections;
 
 public:
@@ -95,7 +295,7 @@ public:
 
 	void Connect(const Slot &aSlot)
 	{
-		mConnections.Put(Hash(&aSlot, sizeof(Slot)), aSlot);
+		mConnections.Connect(aSlot);
 	}
 	template <typename H, typename F> void Connect(H aHolder, F aFunc)
 	{
@@ -104,7 +304,7 @@ public:
 
 	void Disconnect(const Slot &aSlot)
 	{
-		mConnections.Delete(Hash(&aSlot, sizeof(Slot)));
+		mConnections.Disconnect(aSlot);
 	}
 	template <typename H, typename F> void Disconnect(H aHolder, F aFunc)
 	{
@@ -113,7 +313,7 @@ public:
 
 	void operator()(A1 aArg1, A2 aArg2) const
 	{
-		for (Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
+		for (typename Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
 			itor.GetValue()(aArg1, aArg2);
 	}
 };
@@ -124,7 +324,7 @@ public:
 	typedef fastdelegate::FastDelegate<R(A1, A2, A3)> Slot;
 
 private:
-	typedef Database::Typed<Slot> Connections;
+	typedef SignalConnections<Slot> Connections;
 	Connections mConnections;
 
 public:
@@ -133,7 +333,7 @@ public:
 
 	void Connect(const Slot &aSlot)
 	{
-		mConnections.Put(Hash(&aSlot, sizeof(Slot)), aSlot);
+		mConnections.Connect(aSlot);
 	}
 	template <typename H, typename F> void Connect(H aHolder, F aFunc)
 	{
@@ -142,7 +342,7 @@ public:
 
 	void Disconnect(const Slot &aSlot)
 	{
-		mConnections.Delete(Hash(&aSlot, sizeof(Slot)));
+		mConnections.Disconnect(aSlot);
 	}
 	template <typename H, typename F> void Disconnect(H aHolder, F aFunc)
 	{
@@ -151,7 +351,7 @@ public:
 
 	void operator()(A1 aArg1, A2 aArg2, A3 aArg3) const
 	{
-		for (Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
+		for (typename Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
 			itor.GetValue()(aArg1, aArg2, aArg3);
 	}
 };
@@ -162,7 +362,7 @@ public:
 	typedef fastdelegate::FastDelegate<R(A1, A2, A3, A4)> Slot;
 
 private:
-	typedef Database::Typed<Slot> Connections;
+	typedef SignalConnections<Slot> Connections;
 	Connections mConnections;
 
 public:
@@ -171,7 +371,7 @@ public:
 
 	void Connect(const Slot &aSlot)
 	{
-		mConnections.Put(Hash(&aSlot, sizeof(Slot)), aSlot);
+		mConnections.Connect(aSlot);
 	}
 	template <typename H, typename F> void Connect(H aHolder, F aFunc)
 	{
@@ -180,7 +380,7 @@ public:
 
 	void Disconnect(const Slot &aSlot)
 	{
-		mConnections.Delete(Hash(&aSlot, sizeof(Slot)));
+		mConnections.Disconnect(aSlot);
 	}
 	template <typename H, typename F> void Disconnect(H aHolder, F aFunc)
 	{
@@ -189,7 +389,7 @@ public:
 
 	void operator()(A1 aArg1, A2 aArg2, A3 aArg3, A4 aArg4) const
 	{
-		for (Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
+		for (typename Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
 			itor.GetValue()(aArg1, aArg2, aArg3, aArg4);
 	}
 };
@@ -200,7 +400,7 @@ public:
 	typedef fastdelegate::FastDelegate<R(A1, A2, A3, A4, A5)> Slot;
 
 private:
-	typedef Database::Typed<Slot> Connections;
+	typedef SignalConnections<Slot> Connections;
 	Connections mConnections;
 
 public:
@@ -209,7 +409,7 @@ public:
 
 	void Connect(const Slot &aSlot)
 	{
-		mConnections.Put(Hash(&aSlot, sizeof(Slot)), aSlot);
+		mConnections.Connect(aSlot);
 	}
 	template <typename H, typename F> void Connect(H aHolder, F aFunc)
 	{
@@ -218,7 +418,7 @@ public:
 
 	void Disconnect(const Slot &aSlot)
 	{
-		mConnections.Delete(Hash(&aSlot, sizeof(Slot)));
+		mConnections.Disconnect(aSlot);
 	}
 	template <typename H, typename F> void Disconnect(H aHolder, F aFunc)
 	{
@@ -227,7 +427,7 @@ public:
 
 	void operator()(A1 aArg1, A2 aArg2, A3 aArg3, A4 aArg4, A5 aArg5) const
 	{
-		for (Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
+		for (typename Connections::Iterator itor(&mConnections); itor.IsValid(); ++itor)
 			itor.GetValue()(aArg1, aArg2, aArg3, aArg4, aArg5);
 	}
 };
@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include "Simulatable.h"
+#include "Profiler.h"
 
 // list of all simulatables
 static Simulatable *sHead;
@@ -58,6 +59,8 @@ void Simulatable::Deactivate(void)
 
 void Simulatable::SimulateAll(float aStep)
 {
+	PROFILE_ZONE("Simulatable::SimulateAll");
+
 	// simulate all simulatables
 	Simulatable *itor = sHead;
 	while (itor)
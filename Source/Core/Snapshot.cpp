@@ -0,0 +1,396 @@
+#include "StdAfx.h"
+#include "Snapshot.h"
+#include "Entity.h"
+
+namespace Snapshot
+{
+	// snapshot format
+	static const unsigned int MAGIC = 0x50414e53;	// "SNAP"
+	static const unsigned int VERSION = 1;
+
+	// derived ordinal for instances not derived by their creator
+	static const unsigned int NOT_DERIVED = ~0U;
+
+	// restore in progress
+	static bool restoring;
+
+	// instances the restore in progress keeps in place, sorted for lookup
+	static std::vector<unsigned int> inplace;
+
+	// saved instance
+	struct Instance
+	{
+		unsigned int mId;
+		unsigned int mTemplateId;
+		unsigned int mOwnerId;
+		unsigned int mCreatorId;
+		unsigned int mDerived;
+		Transform2 mPrevTransform;
+		Transform2 mTransform;
+		Transform2 mVelocity;
+	};
+
+	namespace Serializer
+	{
+		Database::Typed<Entry> &Custom::GetDB()
+		{
+			static Database::Typed<Entry> serializers;
+			return serializers;
+		}
+		Custom::Custom(unsigned int aDatabaseId, SaveEntry aSave, RestoreEntry aRestore)
+			: mDatabaseId(aDatabaseId)
+		{
+			Database::Typed<Entry> &db = GetDB();
+			mHadPrev = db.FindLocal(mDatabaseId) != NULL;
+			Entry &entry = db.Open(mDatabaseId);
+			mPrev = entry;
+			entry.mSave = aSave;
+			entry.mRestore = aRestore;
+			db.Close(mDatabaseId);
+		}
+		Custom::~Custom()
+		{
+			Database::Typed<Entry> &db = GetDB();
+			if (mHadPrev)
+				db.Put(mDatabaseId, mPrev);
+			else
+				db.Delete(mDatabaseId);
+		}
+
+		Plain::Plain(unsigned int aDatabaseId)
+			: Custom(aDatabaseId, NULL, NULL)
+		{
+		}
+	}
+
+	// saved instance identifiers with their index, sorted for lookup
+	typedef std::vector<std::pair<unsigned int, size_t> > SavedIndex;
+
+	// find a saved instance by identifier
+	static const Instance *FindSaved(const SavedIndex &aSaved, const std::vector<Instance> &aInstances, unsigned int aId)
+	{
+		SavedIndex::const_iterator itor = std::lower_bound(aSaved.begin(), aSaved.end(), std::make_pair(aId, size_t(0)));
+		return (itor != aSaved.end() && itor->first == aId) ? &aInstances[itor->second] : NULL;
+	}
+
+	// clear the serialized records of an instance kept in place
+	// (so serializers restore onto fresh records, as they do for a new instance)
+	static void ClearSerialized(unsigned int aId)
+	{
+		const Database::Typed<Serializer::Entry> &serializers = Serializer::Custom::GetDB();
+		for (Database::Typed<Serializer::Entry>::Iterator itor(&serializers); itor.IsValid(); ++itor)
+		{
+			if (Database::Untyped *database = Database::GetDatabases().Get(itor.GetKey()))
+				database->Delete(aId);
+		}
+	}
+
+	// gather live instances
+	static void GatherInstances(std::vector<unsigned int> &aIds)
+	{
+		for (Database::Typed<Entity *>::Iterator itor(&Database::entity); itor.IsValid(); ++itor)
+		{
+			// templates have no instance handle
+			if (Database::IsValid(Database::GetHandle(itor.GetKey())))
+				aIds.push_back(itor.GetKey());
+		}
+	}
+
+	// save the simulation state
+	void Save(Data &aData)
+	{
+		Writer writer(aData);
+
+		// header
+		writer.Write(MAGIC);
+		writer.Write(VERSION);
+
+		// global state
+		writer.Write(sim_turn);
+		writer.Write(Random::gSeed);
+		writer.Write(Entity::PeekId());
+
+		// gather live instances
+		std::vector<unsigned int> ids;
+		GatherInstances(ids);
+
+		// for each instance...
+		writer.Write(static_cast<unsigned int>(ids.size()));
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			const unsigned int aId = ids[i];
+			const Entity *entity = Database::entity.Get(aId);
+
+			// save identity and motion
+			Instance instance;
+			instance.mId = aId;
+			instance.mTemplateId = Database::parent.Get(aId);
+			instance.mOwnerId = Database::owner.Get(aId);
+			instance.mCreatorId = Database::creator.Get(aId);
+			const unsigned int *derived = Database::derived.FindLocal(aId);
+			instance.mDerived = derived ? *derived : NOT_DERIVED;
+			instance.mPrevTransform = Transform2(entity->GetPrevAngle(), entity->GetPrevPosition());
+			instance.mTransform = entity->GetTransform();
+			instance.mVelocity = Transform2(entity->GetOmega(), entity->GetVelocity());
+			writer.Write(instance);
+		}
+
+		// for each registered serializer...
+		const Database::Typed<Serializer::Entry> &serializers = Serializer::Custom::GetDB();
+		writer.Write(static_cast<unsigned int>(serializers.GetCount()));
+		for (Database::Typed<Serializer::Entry>::Iterator itor(&serializers); itor.IsValid(); ++itor)
+		{
+			const unsigned int aDatabaseId = itor.GetKey();
+			const Serializer::Entry &entry = itor.GetValue();
+			const Database::Untyped *database = Database::GetDatabases().Get(aDatabaseId);
+
+			// section header (record count patched afterward)
+			writer.Write(aDatabaseId);
+			const size_t countposition = writer.GetPosition();
+			unsigned int count = 0;
+			writer.Write(count);
+			if (!database)
+				continue;
+
+			// for each instance with a record...
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				const unsigned int aId = ids[i];
+				const void *record = database->FindLocal(aId);
+				if (!record)
+					continue;
+
+				// record header (size patched afterward)
+				writer.Write(aId);
+				const size_t sizeposition = writer.GetPosition();
+				writer.Write(static_cast<unsigned int>(0));
+
+				// save the record
+				if (entry.mSave)
+					entry.mSave(aId, writer);
+				else
+					writer.Write(record, database->GetStride());
+
+				writer.Patch(sizeposition, static_cast<unsigned int>(writer.GetPosition() - sizeposition - sizeof(unsigned int)));
+				++count;
+			}
+			writer.Patch(countposition, count);
+		}
+	}
+
+	// restore the simulation state
+	bool Restore(const Data &aData)
+	{
+		Reader reader(aData.empty() ? NULL : &aData[0], aData.size());
+
+		// header
+		unsigned int magic, version;
+		if (!reader.Read(magic) || magic != MAGIC || !reader.Read(version) || version != VERSION)
+			return false;
+
+		// global state
+		unsigned int turn, seed, nextid;
+		reader.Read(turn);
+		reader.Read(seed);
+		reader.Read(nextid);
+
+		// instances
+		unsigned int count = 0;
+		reader.Read(count);
+		if (count > reader.GetRemaining() / sizeof(Instance))
+			return false;
+		std::vector<Instance> instances(count);
+		if (count > 0 && !reader.Read(&instances[0], count * sizeof(Instance)))
+			return false;
+
+		restoring = true;
+
+		// saved instance identifiers, sorted for lookup
+		SavedIndex saved(count);
+		for (size_t i = 0; i < count; ++i)
+			saved[i] = std::make_pair(instances[i].mId, i);
+		std::sort(saved.begin(), saved.end());
+
+		// keep live instances the snapshot has with the same template in place,
+		// and delete the rest
+		// (kept instances hold on to their identifier, handle, entity, and the records
+		// their <entity> element configured; they get deactivated here and activated
+		// again below, so nothing sees them deleted and their components come back
+		// from the template as for a new instance; derived instances stay with
+		// the creators that derive them again, unless they were configured)
+		std::vector<unsigned int> live;
+		GatherInstances(live);
+		inplace.clear();
+		for (size_t i = 0; i < live.size(); ++i)
+		{
+			const unsigned int aId = live[i];
+			const Instance *instance = FindSaved(saved, instances, aId);
+			if (instance && (Database::configured.Get(aId) ||
+				(Database::parent.Get(aId) == instance->mTemplateId &&
+				(instance->mDerived == NOT_DERIVED || !FindSaved(saved, instances, instance->mCreatorId)))))
+			{
+				Database::Deactivate(aId);
+				inplace.push_back(aId);
+			}
+			else
+			{
+				Database::Delete(aId);
+			}
+		}
+		std::sort(inplace.begin(), inplace.end());
+		Database::Update();
+
+		// reset kept instances to their saved identity
+		// (level entities keep their serialized records too, since their <entity>
+		// element may have configured them and activation reads them)
+		for (size_t i = 0; i < inplace.size(); ++i)
+		{
+			const unsigned int aId = inplace[i];
+			const Instance &instance = *FindSaved(saved, instances, aId);
+			if (!Database::configured.Get(aId))
+				ClearSerialized(aId);
+			Database::owner.Put(aId, instance.mOwnerId);
+			Database::creator.Put(aId, instance.mCreatorId);
+			if (instance.mDerived != NOT_DERIVED)
+				Database::derived.Put(aId, instance.mDerived);
+			else
+				Database::derived.Delete(aId);
+		}
+
+		// split derived instances from the rest
+		// (a derived instance whose creator is gone gets recreated directly)
+		std::vector<unsigned int> roots;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Instance &instance = instances[i];
+			if (std::binary_search(inplace.begin(), inplace.end(), instance.mId))
+			{
+				roots.push_back(instance.mId);
+			}
+			else if (instance.mDerived != NOT_DERIVED && FindSaved(saved, instances, instance.mCreatorId))
+			{
+				Database::ReuseDerived(instance.mCreatorId, instance.mDerived, instance.mId);
+			}
+			else
+			{
+				Database::Instantiate(instance.mId, instance.mTemplateId, instance.mOwnerId, instance.mCreatorId,
+					instance.mTransform.a, instance.mTransform.p, instance.mVelocity.p, instance.mVelocity.a, false);
+				roots.push_back(instance.mId);
+			}
+		}
+
+		// activate the instances
+		// (creators derive their saved instances again as they activate,
+		// with their original identifiers, and skip the ones that were gone)
+		Database::RestrictDerived(true);
+		if (!roots.empty())
+			Database::ActivateBatch(roots.size(), &roots[0]);
+		Database::Update();
+		Database::ClearDerived();
+
+		// restore motion
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Instance &instance = instances[i];
+			if (Entity *entity = Database::entity.Get(instance.mId))
+			{
+				entity->SetTransform(instance.mTransform);
+				entity->SetPrevAngle(instance.mPrevTransform.a);
+				entity->SetPrevPosition(instance.mPrevTransform.p);
+				entity->SetVelocity(instance.mVelocity.p);
+				entity->SetOmega(instance.mVelocity.a);
+			}
+		}
+
+		// for each saved section...
+		const Database::Typed<Serializer::Entry> &serializers = Serializer::Custom::GetDB();
+		unsigned int sections = 0;
+		reader.Read(sections);
+		std::vector<unsigned char> buffer;
+		for (unsigned int section = 0; section < sections && reader.GetRemaining(); ++section)
+		{
+			unsigned int aDatabaseId = 0, records = 0;
+			reader.Read(aDatabaseId);
+			reader.Read(records);
+
+			// skip sections nothing serializes any more
+			const Serializer::Entry *entry = serializers.FindLocal(aDatabaseId);
+			Database::Untyped *database = Database::GetDatabases().Get(aDatabaseId);
+
+			// for each record...
+			for (unsigned int i = 0; i < records && reader.GetRemaining(); ++i)
+			{
+				unsigned int aId = 0, size = 0;
+				reader.Read(aId);
+				reader.Read(size);
+				Reader record(reader.Split(size));
+
+				// skip records for instances that did not come back
+				if (!entry || !database || !Database::IsValid(Database::GetHandle(aId)))
+					continue;
+
+				// restore the record
+				if (entry->mRestore)
+				{
+					entry->mRestore(aId, record);
+				}
+				else if (size == database->GetStride())
+				{
+					buffer.resize(size);
+					record.Read(&buffer[0], size);
+					database->Put(aId, &buffer[0]);
+				}
+			}
+		}
+
+		// restore global state
+		sim_turn = turn;
+		Random::gSeed = seed;
+		Entity::SetNextId(nextid);
+
+		inplace.clear();
+		restoring = false;
+		return true;
+	}
+
+	// save the simulation state to a file
+	bool SaveFile(const char *aFileName)
+	{
+		Data data;
+		Save(data);
+
+		FILE *file = fopen(aFileName, "wb");
+		if (!file)
+			return false;
+		const bool success = fwrite(&data[0], 1, data.size(), file) == data.size();
+		fclose(file);
+		return success;
+	}
+
+	// restore the simulation state from a file
+	bool LoadFile(const char *aFileName)
+	{
+		FILE *file = fopen(aFileName, "rb");
+		if (!file)
+			return false;
+		fseek(file, 0, SEEK_END);
+		const long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		Data data(size > 0 ? size : 0);
+		const bool success = size > 0 && fread(&data[0], 1, data.size(), file) == data.size();
+		fclose(file);
+		return success && Restore(data);
+	}
+
+	// is a restore in progress?
+	bool IsRestoring(void)
+	{
+		return restoring;
+	}
+
+	// is a restore in progress keeping an instance in place?
+	bool IsRestoringInPlace(unsigned int aId)
+	{
+		return restoring && std::binary_search(inplace.begin(), inplace.end(), aId);
+	}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+namespace Snapshot
+{
+	// snapshot data
+	typedef std::vector<unsigned char> Data;
+
+	// binary writer
+	class GAME_API Writer
+	{
+	private:
+		Data &mData;
+
+	public:
+		Writer(Data &aData)
+			: mData(aData)
+		{
+		}
+
+		// write raw bytes
+		void Write(const void *aBuffer, size_t aSize)
+		{
+			const unsigned char *buffer = static_cast<const unsigned char *>(aBuffer);
+			mData.insert(mData.end(), buffer, buffer + aSize);
+		}
+
+		// write a plain value
+		template <typename T> void Write(const T &aValue)
+		{
+			Write(&aValue, sizeof(T));
+		}
+
+		// get the current write position
+		size_t GetPosition(void) const
+		{
+			return mData.size();
+		}
+
+		// overwrite a plain value at an earlier position
+		template <typename T> void Patch(size_t aPosition, const T &aValue)
+		{
+			memcpy(&mData[aPosition], &aValue, sizeof(T));
+		}
+	};
+
+	// binary reader
+	class GAME_API Reader
+	{
+	private:
+		const unsigned char *mCur;
+		const unsigned char *mEnd;
+
+	public:
+		Reader(const void *aBuffer, size_t aSize)
+			: mCur(static_cast<const unsigned char *>(aBuffer))
+			, mEnd(static_cast<const unsigned char *>(aBuffer) + aSize)
+		{
+		}
+
+		// read raw bytes
+		// (returns false and zero-fills if there is not enough data)
+		bool Read(void *aBuffer, size_t aSize)
+		{
+			if (size_t(mEnd - mCur) < aSize)
+			{
+				memset(aBuffer, 0, aSize);
+				mCur = mEnd;
+				return false;
+			}
+			memcpy(aBuffer, mCur, aSize);
+			mCur += aSize;
+			return true;
+		}
+
+		// read a plain value
+		template <typename T> bool Read(T &aValue)
+		{
+			return Read(&aValue, sizeof(T));
+		}
+
+		// split off a sub-reader for the next bytes
+		Reader Split(size_t aSize)
+		{
+			if (size_t(mEnd - mCur) < aSize)
+				aSize = mEnd - mCur;
+			Reader reader(mCur, aSize);
+			mCur += aSize;
+			return reader;
+		}
+
+		// get the number of bytes left
+		size_t GetRemaining(void) const
+		{
+			return mEnd - mCur;
+		}
+	};
+
+	// record serializers
+	// (databases without one are rebuilt from templates when instances activate;
+	// components holding pointers register one to save and restore their own state)
+	namespace Serializer
+	{
+		typedef void (*SaveEntry)(unsigned int aId, Writer &aWriter);
+		typedef void (*RestoreEntry)(unsigned int aId, Reader &aReader);
+
+		// serializer entry
+		// (null functions copy the record byte for byte)
+		struct Entry
+		{
+			SaveEntry mSave;
+			RestoreEntry mRestore;
+		};
+
+		// custom serializer
+		class GAME_API Custom
+		{
+		private:
+			unsigned int mDatabaseId;
+			Entry mPrev;
+			bool mHadPrev;
+
+		public:
+			static Database::Typed<Entry> &GetDB();
+			Custom(unsigned int aDatabaseId, SaveEntry aSave, RestoreEntry aRestore);
+			~Custom();
+		};
+
+		// plain-data serializer
+		// (records copied byte for byte; only for records without pointers)
+		class GAME_API Plain : public Custom
+		{
+		public:
+			Plain(unsigned int aDatabaseId);
+		};
+	}
+
+	// save the simulation state
+	GAME_API void Save(Data &aData);
+
+	// restore the simulation state
+	// (returns false if the data is not a compatible snapshot)
+	GAME_API bool Restore(const Data &aData);
+
+	// save the simulation state to a file
+	GAME_API bool SaveFile(const char *aFileName);
+
+	// restore the simulation state from a file
+	GAME_API bool LoadFile(const char *aFileName);
+
+	// is a restore in progress?
+	GAME_API bool IsRestoring(void);
+
+	// is a restore in progress keeping an instance in place?
+	// (kept instances get deactivated and activated again without being deleted;
+	// components use this to skip join and leave notifications for them)
+	GAME_API bool IsRestoringInPlace(unsigned int aId);
+}
@@ -1,15 +1,76 @@
 #include "StdAfx.h"
 #include "Updatable.h"
+#include "Profiler.h"
 
-static Updatable *sHead;
-static Updatable *sTail;
-static Updatable *sNext;
+// action function key
+// (the member function an action calls, without the object it calls it on)
+class UpdatableActionKey : public fastdelegate::DelegateMemento
+{
+public:
+	UpdatableActionKey(const fastdelegate::DelegateMemento &aMemento)
+		: DelegateMemento(aMemento)
+	{
+	}
+
+	bool SameFunction(const UpdatableActionKey &aKey) const
+	{
+		return memcmp(&m_pFunction, &aKey.m_pFunction, sizeof(m_pFunction)) == 0;
+	}
+};
+
+// update bucket
+// (contiguous updatables with the same action function;
+// deactivated entries leave a null behind until the bucket gets compacted)
+struct UpdatableBucket
+{
+	UpdatableActionKey mKey;
+	std::vector<Updatable *> mUpdatables;
+	unsigned int mDone;
+	bool mDirty;
+
+	UpdatableBucket(const UpdatableActionKey &aKey)
+		: mKey(aKey)
+		, mDone(0)
+		, mDirty(false)
+	{
+	}
+};
+
+// buckets in order of first activation
+static std::vector<UpdatableBucket> sBuckets;
+
+// bucket entries whose action changed
+// (moved to the bucket for their new action before the next update)
+struct UpdatableMove
+{
+	unsigned int mBucket;
+	unsigned int mIndex;
+};
+static std::vector<UpdatableMove> sMoves;
+
+// bucket sizes at the start of an update pass
+// (kept between updates so the pass loop does not allocate)
+static std::vector<unsigned int> sEnd;
+
+// find or add the bucket for an action
+static unsigned int FindBucket(Updatable::Action &aAction)
+{
+	const UpdatableActionKey key(aAction.GetMemento());
+	for (unsigned int i = 0; i < sBuckets.size(); ++i)
+	{
+		if (sBuckets[i].mKey.SameFunction(key))
+			return i;
+	}
+	sBuckets.push_back(UpdatableBucket(key));
+	return static_cast<unsigned int>(sBuckets.size() - 1);
+}
 
 Updatable::Updatable(unsigned int aId)
 : mId(aId)
-, mNext(NULL)
-, mPrev(NULL)
+, mBucket(0)
+, mIndex(0)
 , mActive(false)
+, mMoving(false)
 , mAction()
 {
 }
@@ -19,18 +80,28 @@ Updatable::~Updatable(void)
 	Deactivate();
 }
 
+void Updatable::SetAction(Action aAction)
+{
+	mAction = aAction;
+
+	// if active, move buckets later
+	// (moving now would run the updatable again this turn if the new bucket comes later)
+	if (mActive && !mMoving)
+	{
+		const UpdatableMove move = { mBucket, mIndex };
+		sMoves.push_back(move);
+		mMoving = true;
+	}
+}
+
 void Updatable::Activate(void)
 {
 	if (!mActive)
 	{
-		mPrev = sTail;
-		if (sTail)
-			sTail->mNext = this;
-		sTail = this;
-		if (!sHead)
-			sHead = this;
-		if (!sNext)
-			sNext = this;
+		mBucket = FindBucket(mAction);
+		std::vector<Updatable *> &updatables = sBuckets[mBucket].mUpdatables;
+		mIndex = static_cast<unsigned int>(updatables.size());
+		updatables.push_back(this);
 		mActive = true;
 	}
 }
@@ -39,36 +110,84 @@ void Updatable::Deactivate(void)
 {
 	if (mActive)
 	{
-		if (sHead == this)
-			sHead = mNext;
-		if (sTail == this)
-			sTail = mPrev;
-		if (sNext == this)
-			sNext = mNext;
-		if (mNext)
-			mNext->mPrev = mPrev;
-		if (mPrev)
-			mPrev->mNext = mNext;
-		mNext = NULL;
-		mPrev = NULL;
+		UpdatableBucket &bucket = sBuckets[mBucket];
+		bucket.mUpdatables[mIndex] = NULL;
+		bucket.mDirty = true;
 		mActive = false;
+		mMoving = false;
 	}
 }
 
 void Updatable::UpdateAll(float aStep)
 {
-	// update all updatables
-	Updatable *itor = sHead;
-	while (itor)
+	PROFILE_ZONE("Updatable::UpdateAll");
+
+	// move updatables whose action changed
+	// (entries deactivated since then are already null)
+	for (unsigned int m = 0; m < sMoves.size(); ++m)
+	{
+		UpdatableBucket &bucket = sBuckets[sMoves[m].mBucket];
+		Updatable *updatable = bucket.mUpdatables[sMoves[m].mIndex];
+		if (!updatable || !updatable->mMoving)
+			continue;
+		updatable->mMoving = false;
+		if (bucket.mKey.SameFunction(UpdatableActionKey(updatable->mAction.GetMemento())))
+			continue;
+		updatable->Deactivate();
+		updatable->Activate();
+	}
+	sMoves.clear();
+
+	// compact buckets with deactivated entries
+	// (keeps activation order within each bucket)
+	for (unsigned int b = 0; b < sBuckets.size(); ++b)
 	{
-		// get the next iterator
-		// (in case the entry gets deleted)
-		sNext = itor->mNext;
+		UpdatableBucket &bucket = sBuckets[b];
+		if (!bucket.mDirty)
+			continue;
+		std::vector<Updatable *> &updatables = bucket.mUpdatables;
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < updatables.size(); ++i)
+		{
+			if (Updatable *updatable = updatables[i])
+			{
+				updatable->mIndex = count;
+				updatables[count++] = updatable;
+			}
+		}
+		updatables.resize(count);
+		bucket.mDirty = false;
+	}
 
-		// perform action
-		(itor->mAction)(aStep);
+	// update all updatables, bucket by bucket
+	// (indices stay valid while actions activate and deactivate updatables:
+	// activation appends, and deactivation leaves a null)
+	for (unsigned int b = 0; b < sBuckets.size(); ++b)
+		sBuckets[b].mDone = 0;
+	std::vector<unsigned int> &end = sEnd;
+	for (;;)
+	{
+		// updatables activated during a pass run in the next pass,
+		// after the ones already active, whatever bucket they land in
+		end.resize(sBuckets.size());
+		bool pending = false;
+		for (unsigned int b = 0; b < sBuckets.size(); ++b)
+		{
+			end[b] = static_cast<unsigned int>(sBuckets[b].mUpdatables.size());
+			pending |= sBuckets[b].mDone < end[b];
+		}
+		if (!pending)
+			break;
 
-		// go to the next iterator
-		itor = sNext;
+		for (unsigned int b = 0; b < end.size(); ++b)
+		{
+			for (unsigned int i = sBuckets[b].mDone; i < end[b]; ++i)
+			{
+				// perform action
+				if (Updatable *updatable = sBuckets[b].mUpdatables[i])
+					(updatable->mAction)(aStep);
+			}
+			sBuckets[b].mDone = end[b];
+		}
 	}
 }
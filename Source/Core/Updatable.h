@@ -10,10 +10,12 @@ protected:
 	unsigned int mId;
 
 private:
-	// linked list
-	Updatable *mNext;
-	Updatable *mPrev;
+	// update bucket
+	// (updatables sharing an action function update together, in activation order)
+	unsigned int mBucket;
+	unsigned int mIndex;
 	bool mActive;
+	bool mMoving;
 
 	// action
 	Action mAction;
@@ -23,9 +25,14 @@ public:
 	virtual ~Updatable(void);
 
 	// set action
-	void SetAction(Action aAction)
+	// (takes effect immediately; an active updatable moves to the bucket
+	// for the new action at the start of the next update)
+	void SetAction(Action aAction);
+
+	// get action
+	const Action &GetAction(void) const
 	{
-		mAction = aAction;
+		return mAction;
 	}
 
 	// activate
@@ -39,7 +46,7 @@ public:
 	}
 
 	// is active?
-	bool IsActive(void)
+	bool IsActive(void) const
 	{
 		return mActive;
 	}
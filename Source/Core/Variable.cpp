@@ -1,7 +1,298 @@
 #include "StdAfx.h"
 #include "Variable.h"
+#include "Snapshot.h"
 
 namespace Database
 {
-	Typed<Typed<float> > variable(0x19385305 /* "variable" */);
+	Typed<Variables> variable(0x19385305 /* "variable" */);
+
+	// variable layout
+	// (shared by every entity; offsets never move once registered)
+	static Typed<unsigned int> &GetLayout(void)
+	{
+		static Typed<unsigned int> layout;
+		return layout;
+	}
+	static std::vector<Key> layoutnames;	// name at each offset (0 if unused)
+	static unsigned int layoutscalar;		// next packed scalar offset
+
+	// register a variable name
+	unsigned int Variables::Register(Key aName, unsigned int aWidth)
+	{
+		Typed<unsigned int> &layout = GetLayout();
+		assert(aWidth >= 1 && aWidth <= 4);
+
+		// if the name already has an offset...
+		if (const unsigned int *found = layout.FindLocal(aName))
+		{
+			const unsigned int offset = *found;
+			if (aWidth == 1)
+				return offset;
+
+			// wider variables need an aligned run of consecutive names
+			if (offset & 3)
+				return NO_SLOT;
+			for (unsigned int i = 1; i < aWidth; ++i)
+			{
+				const unsigned int *next = layout.FindLocal(aName + i);
+				if (next ? *next != offset + i : layoutnames[offset + i] != 0)
+					return NO_SLOT;
+			}
+
+			// claim the rest of the run
+			for (unsigned int i = 1; i < aWidth; ++i)
+			{
+				if (!layoutnames[offset + i])
+				{
+					layout.Put(aName + i, offset + i);
+					layoutnames[offset + i] = aName + i;
+				}
+			}
+			Migrate(aName, aWidth);
+			return offset;
+		}
+
+		// wider variables cannot take names already placed elsewhere
+		for (unsigned int i = 1; i < aWidth; ++i)
+		{
+			if (layout.FindLocal(aName + i))
+				return NO_SLOT;
+		}
+
+		// pack scalars together in their own groups of four
+		// (skipping entries a wider variable claimed)
+		while ((layoutscalar & 3) && layoutnames[layoutscalar])
+			++layoutscalar;
+		unsigned int offset;
+		if (aWidth == 1 && (layoutscalar & 3))
+		{
+			offset = layoutscalar++;
+		}
+		else
+		{
+			offset = static_cast<unsigned int>(layoutnames.size());
+			layoutnames.resize(offset + 4, 0);
+			if (aWidth == 1)
+				layoutscalar = offset + 1;
+		}
+
+		// map the names
+		for (unsigned int i = 0; i < aWidth; ++i)
+		{
+			layout.Put(aName + i, offset + i);
+			layoutnames[offset + i] = aName + i;
+		}
+		Migrate(aName, aWidth);
+		return offset;
+	}
+
+	// move newly registered names out of every keyed fallback
+	// (values written before a name was registered would otherwise be hidden)
+	void Variables::Migrate(Key aName, unsigned int aWidth)
+	{
+		for (Typed<Variables>::Iterator itor(&variable); itor.IsValid(); ++itor)
+		{
+			Variables &variables = const_cast<Variables &>(itor.GetValue());
+			if (!variables.mDynamic)
+				continue;
+			for (unsigned int i = 0; i < aWidth; ++i)
+			{
+				if (const float *value = variables.mDynamic->FindLocal(aName + i))
+				{
+					*variables.OpenSlot(GetSlot(aName + i)) = *value;
+					variables.mDynamic->Delete(aName + i);
+				}
+			}
+		}
+	}
+
+	// get the offset for a registered name
+	unsigned int Variables::GetSlot(Key aName)
+	{
+		const unsigned int *found = GetLayout().FindLocal(aName);
+		return found ? *found : NO_SLOT;
+	}
+
+	Variables::Variables(void)
+		: mBlock(NULL), mBase(0), mSize(0), mDynamic(NULL)
+	{
+	}
+
+	Variables::Variables(const Variables &aSource)
+		: mBlock(NULL), mBase(0), mSize(0), mDynamic(NULL)
+	{
+		*this = aSource;
+	}
+
+	Variables::~Variables(void)
+	{
+		_mm_free(mBlock);
+		delete mDynamic;
+	}
+
+	Variables &Variables::operator=(const Variables &aSource)
+	{
+		if (this != &aSource)
+		{
+			_mm_free(mBlock);
+			mBlock = NULL;
+			mBase = aSource.mBase;
+			mSize = aSource.mSize;
+			if (mSize)
+			{
+				mBlock = static_cast<__m128 *>(_mm_malloc(mSize * sizeof(float), 16));
+				memcpy(mBlock, aSource.mBlock, mSize * sizeof(float));
+			}
+
+			delete mDynamic;
+			mDynamic = aSource.mDynamic ? new Typed<float>(*aSource.mDynamic) : NULL;
+		}
+		return *this;
+	}
+
+	// get a writable slot
+	// (grows the block over the groups of four between it and the offset,
+	// at least doubling it within the layout so repeated growth stays cheap;
+	// a template's variables register together, so its offsets tend to be close)
+	float *Variables::OpenSlot(unsigned int aOffset)
+	{
+		if (aOffset - mBase >= mSize)
+		{
+			const unsigned int limit = static_cast<unsigned int>(layoutnames.size());
+			unsigned int base = aOffset & ~3U;
+			unsigned int end = (aOffset | 3U) + 1;
+			if (mSize)
+			{
+				if (base > mBase)
+				{
+					base = mBase;
+					end = std::min(std::max(end, mBase + mSize * 2), limit);
+				}
+				else
+				{
+					base = mBase > mSize ? std::min(base, mBase - mSize) : 0;
+					end = mBase + mSize;
+				}
+			}
+			const unsigned int size = end - base;
+			__m128 *block = static_cast<__m128 *>(_mm_malloc(size * sizeof(float), 16));
+			memset(block, 0, size * sizeof(float));
+			if (mSize)
+				memcpy(reinterpret_cast<float *>(block) + (mBase - base), mBlock, mSize * sizeof(float));
+			_mm_free(mBlock);
+			mBlock = block;
+			mBase = base;
+			mSize = size;
+		}
+		return reinterpret_cast<float *>(mBlock) + (aOffset - mBase);
+	}
+
+	float Variables::Get(Key aName) const
+	{
+		const unsigned int offset = GetSlot(aName);
+		if (offset != NO_SLOT)
+			return GetSlotValue(offset);
+		return mDynamic ? mDynamic->Get(aName) : 0.0f;
+	}
+
+	void Variables::Put(Key aName, float aValue)
+	{
+		const unsigned int offset = GetSlot(aName);
+		if (offset != NO_SLOT)
+		{
+			*OpenSlot(offset) = aValue;
+			return;
+		}
+		if (!mDynamic)
+			mDynamic = new Typed<float>;
+		mDynamic->Put(aName, aValue);
+	}
+
+	float &Variables::Open(Key aName)
+	{
+		const unsigned int offset = GetSlot(aName);
+		if (offset != NO_SLOT)
+			return *OpenSlot(offset);
+		if (!mDynamic)
+			mDynamic = new Typed<float>;
+		return mDynamic->Open(aName);
+	}
+
+	void Variables::Close(Key aName)
+	{
+		if (mDynamic && GetSlot(aName) == NO_SLOT)
+			mDynamic->Close(aName);
+	}
+
+	void Variables::Delete(Key aName)
+	{
+		const unsigned int offset = GetSlot(aName);
+		if (offset != NO_SLOT)
+		{
+			if (offset - mBase < mSize)
+				reinterpret_cast<float *>(mBlock)[offset - mBase] = 0.0f;
+			return;
+		}
+		if (mDynamic)
+			mDynamic->Delete(aName);
+	}
+
+	// save as name/value pairs
+	// (offsets depend on configure order, so they are not saved)
+	void Variables::Save(Snapshot::Writer &aWriter) const
+	{
+		const float *values = reinterpret_cast<const float *>(mBlock);
+		unsigned int count = mDynamic ? static_cast<unsigned int>(mDynamic->GetCount()) : 0;
+		for (unsigned int index = 0; index < mSize; ++index)
+		{
+			if (values[index] != 0.0f)
+				++count;
+		}
+		aWriter.Write(count);
+		for (unsigned int index = 0; index < mSize; ++index)
+		{
+			if (values[index] != 0.0f)
+			{
+				aWriter.Write(layoutnames[mBase + index]);
+				aWriter.Write(values[index]);
+			}
+		}
+		if (mDynamic)
+		{
+			for (Typed<float>::Iterator itor(mDynamic); itor.IsValid(); ++itor)
+			{
+				aWriter.Write(itor.GetKey());
+				aWriter.Write(itor.GetValue());
+			}
+		}
+	}
+
+	// restore from name/value pairs
+	void Variables::Restore(Snapshot::Reader &aReader)
+	{
+		unsigned int count = 0;
+		aReader.Read(count);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			Key key;
+			float value;
+			if (!aReader.Read(key) || !aReader.Read(value))
+				break;
+			Put(key, value);
+		}
+	}
+
+	namespace Serializer
+	{
+		static void VariableSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::variable.Get(aId).Save(aWriter);
+		}
+		static void VariableRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			Database::variable.Open(aId).Restore(aReader);
+			Database::variable.Close(aId);
+		}
+		Snapshot::Serializer::Custom variableserializer(0x19385305 /* "variable" */, VariableSave, VariableRestore);
+	}
 }
@@ -1,6 +1,74 @@
 #pragma once
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 namespace Database
 {
-	extern GAME_API Typed<Typed<float> > variable;
+	// per-entity variables
+	// (names registered at configure time map to fixed offsets in a shared layout,
+	// with vector variables on 16-byte boundaries; each entity's block only spans
+	// the offsets it has written; other names use a keyed fallback)
+	class GAME_API Variables
+	{
+	public:
+		// no fixed offset
+		static const unsigned int NO_SLOT = ~0U;
+
+		// register a variable name with a width of 1 to 4 floats
+		// (returns the offset of the first float, or NO_SLOT if the name cannot have one)
+		static unsigned int Register(Key aName, unsigned int aWidth);
+
+		// get the offset for a registered name
+		// (returns NO_SLOT if the name is not registered)
+		static unsigned int GetSlot(Key aName);
+
+	private:
+		__m128 *mBlock;			// slot block
+		unsigned int mBase;		// offset of the first float in the slot block
+		unsigned int mSize;		// number of floats in the slot block
+		Typed<float> *mDynamic;	// variables without a fixed offset
+
+		float *OpenSlot(unsigned int aOffset);
+		static void Migrate(Key aName, unsigned int aWidth);
+
+	public:
+		Variables(void);
+		Variables(const Variables &aSource);
+		~Variables(void);
+
+		Variables &operator=(const Variables &aSource);
+
+		// get a variable by offset
+		float GetSlotValue(unsigned int aOffset) const
+		{
+			const unsigned int index = aOffset - mBase;
+			return index < mSize ? reinterpret_cast<const float *>(mBlock)[index] : 0.0f;
+		}
+
+		// get a vector variable by offset
+		__m128 GetSlotVector(unsigned int aOffset) const
+		{
+			const unsigned int index = aOffset - mBase;
+			return index < mSize ? mBlock[index >> 2] : _mm_setzero_ps();
+		}
+
+		// keyed access
+		// (names with a fixed offset go to the slot block; as with a database,
+		// an opened value is only good until the next write)
+		float Get(Key aName) const;
+		void Put(Key aName, float aValue);
+		float &Open(Key aName);
+		void Close(Key aName);
+		void Delete(Key aName);
+
+		// save and restore as name/value pairs
+		void Save(Snapshot::Writer &aWriter) const;
+		void Restore(Snapshot::Reader &aReader);
+	};
+
+	extern GAME_API Typed<Variables> variable;
 }
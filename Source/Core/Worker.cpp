@@ -0,0 +1,133 @@
+#include "StdAfx.h"
+#include "Worker.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Worker
+{
+	// worker threads
+	static std::vector<std::thread> sThreads;
+
+	// shared job state
+	// (written under the mutex before the workers wake)
+	static std::mutex sMutex;
+	static std::condition_variable sWake;
+	static std::condition_variable sDone;
+	static Job sJob;
+	static size_t sCount;
+	static size_t sBatch;
+	static std::atomic<size_t> sNext;
+	static unsigned int sGeneration;
+	static int sBusy;
+	static bool sQuit;
+
+	// claim and run batches until none are left
+	static void Drain(void)
+	{
+		for (;;)
+		{
+			const size_t begin = sNext.fetch_add(sBatch);
+			if (begin >= sCount)
+				break;
+			sJob(begin, std::min(begin + sBatch, sCount));
+		}
+	}
+
+	// worker thread
+	static void Main(void)
+	{
+		unsigned int generation = 0;
+		std::unique_lock<std::mutex> lock(sMutex);
+		for (;;)
+		{
+			// wait for a new job
+			while (!sQuit && sGeneration == generation)
+				sWake.wait(lock);
+			if (sQuit)
+				break;
+			generation = sGeneration;
+
+			// help with the job
+			lock.unlock();
+			Drain();
+			lock.lock();
+
+			// check in
+			// (every worker checks in for every job, so none can miss one)
+			if (--sBusy == 0)
+				sDone.notify_one();
+		}
+	}
+
+	// start worker threads
+	void Init(int aCount)
+	{
+		Done();
+
+		sQuit = false;
+		sGeneration = 0;
+		for (int i = 0; i < aCount; ++i)
+			sThreads.push_back(std::thread(Main));
+	}
+
+	// stop worker threads
+	void Done(void)
+	{
+		if (sThreads.empty())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(sMutex);
+			sQuit = true;
+		}
+		sWake.notify_all();
+
+		for (size_t i = 0; i < sThreads.size(); ++i)
+			sThreads[i].join();
+		sThreads.clear();
+	}
+
+	// get the number of worker threads
+	int GetCount(void)
+	{
+		return int(sThreads.size());
+	}
+
+	// run a job over a range in batches
+	void Run(size_t aCount, size_t aBatch, Job aJob)
+	{
+		if (aBatch < 1)
+			aBatch = 1;
+
+		// run directly if there is nothing to share
+		if (sThreads.empty() || aCount <= aBatch)
+		{
+			if (aCount > 0)
+				aJob(0, aCount);
+			return;
+		}
+
+		// post the job
+		{
+			std::lock_guard<std::mutex> lock(sMutex);
+			sJob = aJob;
+			sCount = aCount;
+			sBatch = aBatch;
+			sNext = 0;
+			sBusy = int(sThreads.size());
+			++sGeneration;
+		}
+		sWake.notify_all();
+
+		// help with the job
+		Drain();
+
+		// wait for the workers to check in
+		std::unique_lock<std::mutex> lock(sMutex);
+		while (sBusy > 0)
+			sDone.wait(lock);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// worker threads
+// (split an index range into batches and run them across threads;
+// the calling thread runs batches too and returns when all are done)
+namespace Worker
+{
+	// job over the index range [begin, end)
+	typedef fastdelegate::FastDelegate<void (size_t, size_t)> Job;
+
+	// start worker threads
+	// (stops any running ones first; zero runs every job on the calling thread)
+	GAME_API void Init(int aCount);
+
+	// stop worker threads
+	GAME_API void Done(void);
+
+	// get the number of worker threads
+	GAME_API int GetCount(void);
+
+	// run a job over a range in batches of up to aBatch indices
+	GAME_API void Run(size_t aCount, size_t aBatch, Job aJob);
+}
@@ -17,7 +17,36 @@ namespace Database
 			element->QueryFloatAttribute("xmax", &aMaxX);
 			element->QueryFloatAttribute("ymax", &aMaxY);
 			element->QueryBoolAttribute("wall", &aWall);
-			Collidable::WorldInit(aMinX, aMinY, aMaxX, aMaxY, aWall != 0);
+
+			// physics solver settings
+			CollidableSolverDef solver;
+			switch (Hash(element->Attribute("solver")))
+			{
+			case 0x3553e285 /* "space" */:
+				solver.mThreaded = false;
+				break;
+
+			case 0x30f97f24 /* "hasty" */:
+				solver.mThreaded = true;
+				break;
+			}
+			element->QueryIntAttribute("threads", &solver.mThreads);
+			element->QueryIntAttribute("iterations", &solver.mIterations);
+			switch (Hash(element->Attribute("index")))
+			{
+			case 0x3f754395 /* "bbtree" */:
+				solver.mSpatialHash = false;
+				break;
+
+			case 0xcec577d1 /* "hash" */:
+				solver.mSpatialHash = true;
+				break;
+			}
+			element->QueryFloatAttribute("cellsize", &solver.mCellSize);
+			element->QueryIntAttribute("cellcount", &solver.mCellCount);
+			element->QueryFloatAttribute("slop", &solver.mSlop);
+
+			Collidable::WorldInit(aMinX, aMinY, aMaxX, aMaxY, aWall != 0, solver);
 
 			// recurse on children
 			ConfigureWorldItems(element);
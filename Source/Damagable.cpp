@@ -4,6 +4,8 @@
 #include "Updatable.h"
 #include "Link.h"
 #include "Variable.h"
+#include "Snapshot.h"
+#include "Digest.h"
 
 #ifdef USE_POOL_ALLOCATOR
 // damagable pool
@@ -28,6 +30,38 @@ namespace Database
 	Typed<Damagable::KillSignal > killsignal(0xa2bf0d7d /* "killsignal" */);
 	Typed<int> hitcombo(0xa2610244 /* "hitcombo" */);
 
+	namespace Serializer
+	{
+		static void DamagableSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::damagable.Get(aId)->Save(aWriter);
+		}
+		static void DamagableRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Damagable *damagable = Database::damagable.Get(aId))
+				damagable->Restore(aReader);
+		}
+		Snapshot::Serializer::Custom damagableserializer(0x1b715375 /* "damagable" */, DamagableSave, DamagableRestore);
+
+		Snapshot::Serializer::Plain hitcomboserializer(0xa2610244 /* "hitcombo" */);
+	}
+
+	namespace Digest
+	{
+		static unsigned int DamagableHash(void)
+		{
+			unsigned int sum = 0;
+			for (Typed<Damagable *>::Iterator itor(&Database::damagable); itor.IsValid(); ++itor)
+			{
+				::Digest::Hasher hasher(itor.GetKey());
+				hasher.Add(itor.GetValue()->GetHealth());
+				sum += hasher.Finish();
+			}
+			return sum;
+		}
+		::Digest::Section damagablesection(0x1b715375 /* "damagable" */, "damagable", DamagableHash);
+	}
+
 	namespace Loader
 	{
 		static void DamagableConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
@@ -139,6 +173,18 @@ void DamagableKillUpdate::operator delete(void *aPtr)
 }
 #endif
 
+// save snapshot state
+void Damagable::Save(Snapshot::Writer &aWriter) const
+{
+	aWriter.Write(mHealth);
+}
+
+// restore snapshot state
+void Damagable::Restore(Snapshot::Reader &aReader)
+{
+	aReader.Read(mHealth);
+}
+
 void Damagable::Damage(unsigned int aSourceId, float aDamage)
 {
 	// ignore damage if already destroyed
@@ -148,7 +194,7 @@ void Damagable::Damage(unsigned int aSourceId, float aDamage)
 	const DamagableTemplate &damagable = Database::damagabletemplate.Get(mId);
 
 	// update last hit time (HACK)
-	Database::Typed<float> &variables = Database::variable.Open(mId);
+	Database::Variables &variables = Database::variable.Open(mId);
 	variables.Put(0xd62af07e /* "lasthit" */, float(sim_turn + sim_fraction) / float(sim_rate));
 	Database::variable.Close(mId);
 
@@ -20,6 +20,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 class GAME_API Damagable
 {
 protected:
@@ -56,6 +62,10 @@ public:
 	{
 		return mHealth > 0.0f;
 	}
+
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
 };
 
 namespace Database
@@ -4,6 +4,7 @@
 #include "Entity.h"
 #include "Variable.h"
 #include "Player.h"
+#include "Snapshot.h"
 
 
 #ifdef USE_POOL_ALLOCATOR
@@ -25,6 +26,25 @@ namespace Database
 	Typed<ExpireTemplate> expiretemplate(0x40558d04 /* "expiretemplate" */);
 	Typed<Expire *> expire(0x80459822 /* "expire" */);
 
+	namespace Serializer
+	{
+		static void ExpireSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			const Expire *expire = Database::expire.Get(aId);
+			aWriter.Write(expire->mTurn);
+			aWriter.Write(expire->mFraction);
+		}
+		static void ExpireRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Expire *expire = Database::expire.Get(aId))
+			{
+				aReader.Read(expire->mTurn);
+				aReader.Read(expire->mFraction);
+			}
+		}
+		Snapshot::Serializer::Custom expireserializer(0x80459822 /* "expire" */, ExpireSave, ExpireRestore);
+	}
+
 	namespace Loader
 	{
 		static void ExpireConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
@@ -130,7 +150,7 @@ Expire::Expire(const ExpireTemplate &aTemplate, unsigned int aId)
 
 			// place a mark at the aim point
 			Vector2 localpos = entity->GetTransform().Unrotate(entity->GetVelocity() * aTime);
-			Database::Typed<float> &variables = Database::variable.Open(aId);
+			Database::Variables &variables = Database::variable.Open(aId);
 			variables.Put(0x8dfebaf1 /* "localaim" */ + 0, localpos.x);
 			variables.Put(0x8dfebaf1 /* "localaim" */ + 1, localpos.y);
 			variables.Put(0x8dfebaf1 /* "localaim" */ + 2, 0.0f);
@@ -2,10 +2,12 @@
 #include "Explosion.h"
 #include "Entity.h"
 #include "Collidable.h"
+#include "TargetIndex.h"
 #include "Damagable.h"
 #include "Cancelable.h"
 #include "Team.h"
 #include "ExpressionConfigure.h"
+#include "Snapshot.h"
 
 #include "Bullet.h"
 
@@ -40,6 +42,20 @@ namespace Database
 		Configure explosionconfigure(0x02bb1fe0 /* "explosion" */, ExplosionConfigure);
 	}
 
+	namespace Serializer
+	{
+		static void ExplosionSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::explosion.Get(aId)->Save(aWriter);
+		}
+		static void ExplosionRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Explosion *explosion = Database::explosion.Get(aId))
+				explosion->Restore(aReader);
+		}
+		Snapshot::Serializer::Custom explosionserializer(0x02bb1fe0 /* "explosion" */, ExplosionSave, ExplosionRestore);
+	}
+
 	namespace Initializer
 	{
 		static void ExplosionActivate(unsigned int aId)
@@ -139,6 +155,24 @@ Explosion::~Explosion(void)
 {
 }
 
+// save snapshot state
+// (a zero life span still updates once, so expiry gets saved too)
+void Explosion::Save(Snapshot::Writer &aWriter) const
+{
+	aWriter.Write(mLife);
+	aWriter.Write(IsActive());
+}
+
+// restore snapshot state
+void Explosion::Restore(Snapshot::Reader &aReader)
+{
+	bool active = true;
+	aReader.Read(mLife);
+	aReader.Read(active);
+	if (!active)
+		Deactivate();
+}
+
 class ExplosionQueryCallback
 {
 public:
@@ -149,24 +183,11 @@ public:
 	float mCurDamage[2];
 
 public:
-	void Report(CollidableShape* shape, float distance, const Vector2 &point)
+	void Report(const TargetIndex::Target &target, float distance, const Vector2 &point)
 	{
-		// skip unhittable shapes
-		if (Collidable::IsSensor(shape))
-			return;
-		if (!Collidable::CheckFilter(mExplosion.mFilter, Collidable::GetFilter(shape)))
-			return;
-
-		// get the collidable identifier
-		unsigned int targetId = Collidable::GetId(shape);
-
-		// skip non-entity
-		if (targetId == 0)
-			return;
-
-		// skip self
-		if (targetId == mId)
-			return;
+		// get the target identifier
+		// (the index already skipped sensors, filtered shapes, and self)
+		unsigned int targetId = target.mId;
 
 		// apply damage falloff
 		float damage;
@@ -257,9 +278,10 @@ void Explosion::Update(float aStep)
 		// world-to-local transform
 		callback.mTransform = entity->GetTransform().Inverse();
 
-		// get shapes within the radius
-		Collidable::QueryRadius(entity->GetPosition(), callback.mCurRadius[1], explosion.mFilter,
-			Collidable::QueryRadiusDelegate(&callback, &ExplosionQueryCallback::Report));
+		// get damagable and cancelable shapes within the radius
+		TargetIndex::Query query(entity->GetPosition(), callback.mCurRadius[1], explosion.mFilter);
+		query.mSkipId = mId;
+		TargetIndex::QueryRadius(query, TargetIndex::QueryDelegate(&callback, &ExplosionQueryCallback::Report));
 	}
 
 	// advance life timer
@@ -24,6 +24,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element, unsigned int id);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 class Explosion :
 	public Updatable
 {
@@ -44,6 +50,10 @@ public:
 
 	// update
 	void Update(float aStep);
+
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
 };
 
 namespace Database
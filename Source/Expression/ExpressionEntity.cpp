@@ -4,7 +4,7 @@
 #include "Entity.h"
 #include "Variable.h"
 
-EntityContext::EntityContext(const unsigned int *aBuffer, const size_t aSize, float aParam, unsigned int aId, Database::Typed<float> *aVars)
+EntityContext::EntityContext(const unsigned int *aBuffer, const size_t aSize, float aParam, unsigned int aId, Database::Variables *aVars)
 : Expression::Context(aBuffer)
 , mBegin(aBuffer)
 , mEnd(aBuffer + aSize)
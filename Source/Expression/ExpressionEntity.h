@@ -2,6 +2,11 @@
 
 #include "Expression.h"
 
+namespace Database
+{
+	class Variables;
+}
+
 // entity context
 // (extends expression context)
 struct EntityContext : public Expression::Context
@@ -10,10 +15,10 @@ struct EntityContext : public Expression::Context
 	const unsigned int *mEnd;
 	float mParam;
 	unsigned int mId;
-	Database::Typed<float> *mVars;
+	Database::Variables *mVars;
 	bool mOwned;
 
-	GAME_API EntityContext(const unsigned int *aBuffer, const size_t aSize, float aParam, unsigned int aId, Database::Typed<float> *aVars = NULL);
+	GAME_API EntityContext(const unsigned int *aBuffer, const size_t aSize, float aParam, unsigned int aId, Database::Variables *aVars = NULL);
 	GAME_API ~EntityContext();
 
 	void Restart(void)
@@ -2,6 +2,7 @@
 
 #include "ExpressionIntegral.h"
 #include "ExpressionEntity.h"
+#include "Variable.h"
 
 // evaluate integral
 float EvaluateIntegral(EntityContext &aContext)
@@ -188,7 +188,7 @@ template <typename T> void ConfigureInterpolator(const tinyxml2::XMLElement *ele
 	else if (const char *input = element->Attribute("param"))
 	{
 		// attribute variable reference
-		Expression::Append(buffer, EvaluateVariable<float>, Hash(input));
+		AppendVariable<float>(buffer, Hash(input));
 	}
 	else
 	{
@@ -68,7 +68,7 @@ static bool ConfigureParameter(const tinyxml2::XMLElement *element, const char *
 				Expression::Append(buffer, op);
 
 			// attribute variable reference
-			Expression::Append(buffer, EvaluateVariable<float>, Hash(name));
+			AppendVariable<float>(buffer, Hash(name));
 			return true;
 		}
 	}
@@ -140,7 +140,7 @@ void ConfigureSineWave(const tinyxml2::XMLElement *element, std::vector<unsigned
 	else if (const char *input = element->Attribute("input"))
 	{
 		// attribute variable reference
-		Expression::Append(buffer, EvaluateVariable<float>, Hash(input));
+		AppendVariable<float>(buffer, Hash(input));
 	}
 	else
 	{
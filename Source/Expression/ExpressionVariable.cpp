@@ -6,21 +6,30 @@
 // evaluate boolean variable
 template <> bool EvaluateVariable(EntityContext &aContext)
 {
+	unsigned int slot = Expression::Read<unsigned int>(aContext);
 	unsigned int name = Expression::Read<unsigned int>(aContext);
+	if (slot != Database::Variables::NO_SLOT)
+		return aContext.mVars->GetSlotValue(slot) != 0.0f;
 	return aContext.mVars->Get(name) != 0.0f;
 }
 
 // evaluate scalar variable
 template <> float EvaluateVariable(EntityContext &aContext)
 {
+	unsigned int slot = Expression::Read<unsigned int>(aContext);
 	unsigned int name = Expression::Read<unsigned int>(aContext);
+	if (slot != Database::Variables::NO_SLOT)
+		return aContext.mVars->GetSlotValue(slot);
 	return aContext.mVars->Get(name);
 }
 
 // evaluate vector variable
 template <> __m128 EvaluateVariable(EntityContext &aContext)
 {
+	unsigned int slot = Expression::Read<unsigned int>(aContext);
 	unsigned int name = Expression::Read<unsigned int>(aContext);
+	if (slot != Database::Variables::NO_SLOT)
+		return aContext.mVars->GetSlotVector(slot);
 	__m128 ret = _mm_setzero_ps();
 	for (register int i = 0; i < 4; ++i)
 		ret.m128_f32[i] = aContext.mVars->Get(name+i);
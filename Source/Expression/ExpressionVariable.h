@@ -3,6 +3,7 @@
 #include "Expression.h"
 #include "ExpressionSchema.h"
 #include "ExpressionEntity.h"
+#include "Variable.h"
 
 
 //
@@ -13,6 +14,13 @@
 // evaluate typed variable
 template <typename T> T EvaluateVariable(EntityContext &aContext);
 
+// append a variable expression
+// (resolves the name to a fixed offset, keeping the name for the keyed fallback)
+template <typename T> void AppendVariable(std::vector<unsigned int> &buffer, unsigned int aName)
+{
+	Expression::Append(buffer, EvaluateVariable<T>, Database::Variables::Register(aName, Expression::Schema<T>::COUNT), aName);
+}
+
 // typed variable: attribute-inlined version
 template <typename T> void ConfigureInlineVariable(const tinyxml2::XMLElement *element, std::vector<unsigned int> &buffer, const char * const names[], const float defaults[])
 {
@@ -20,7 +28,7 @@ template <typename T> void ConfigureInlineVariable(const tinyxml2::XMLElement *e
 #ifdef PRINT_CONFIGURE_EXPRESSION
 	DebugPrint("%s variable %s (inline)\n", Expression::Schema<T>::NAME, element->Attribute("variable"));
 #endif
-	Expression::Append(buffer, EvaluateVariable<T>, Hash(element->Attribute("variable")));
+	AppendVariable<T>(buffer, Hash(element->Attribute("variable")));
 }
 
 // typed variable: normal version
@@ -30,7 +38,7 @@ template <typename T> void ConfigureVariable(const tinyxml2::XMLElement *element
 #ifdef PRINT_CONFIGURE_EXPRESSION
 	DebugPrint("%s variable %s\n", Expression::Schema<T>::NAME, element->Attribute("name"));
 #endif
-	Expression::Append(buffer, EvaluateVariable<T>, Hash(element->Attribute("name")));
+	AppendVariable<T>(buffer, Hash(element->Attribute("name")));
 }
 
 // typed variable: tag-named version
@@ -40,5 +48,5 @@ template <typename T> void ConfigureTagVariable(const tinyxml2::XMLElement *elem
 #ifdef PRINT_CONFIGURE_EXPRESSION
 	DebugPrint("%s variable %s (tag)\n", Expression::Schema<T>::NAME, element->Value());
 #endif
-	Expression::Append(buffer, EvaluateVariable<T>, Hash(element->Value()));
+	AppendVariable<T>(buffer, Hash(element->Value()));
 }
@@ -15,4 +15,37 @@ enum GameStateType
 extern GameStateType curgamestate;
 extern GameStateType setgamestate;
 
-extern bool GameStateUpdate(void);
\ No newline at end of file
+extern bool GameStateUpdate(void);
+
+// simulation turn phases
+enum SimulationPhase
+{
+	SIMULATION_PHASE_CONTROL,
+	SIMULATION_PHASE_SIMULATE,
+	SIMULATION_PHASE_COLLIDE,
+	SIMULATION_PHASE_UPDATE,
+	NUM_SIMULATION_PHASES
+};
+
+// input journal for recording and playback
+class Journal;
+extern Journal journal;
+
+// open the input journal for the play state
+// (records or plays back RECORD_CONFIG if requested)
+extern void OpenJournal(void);
+
+// simulate one turn
+// (phase timers may be NULL; returns false when playback runs out of turns)
+class PerfTimer;
+extern bool SimulateTurn(PerfTimer aPhaseTimer[NUM_SIMULATION_PHASES]);
+
+// seek playback to a turn
+// (restores the nearest keyframe and simulates forward from it)
+extern bool SeekTurn(unsigned int aTurn);
+
+// run the play state without a window, rendering, or audio
+extern int RunHeadless(void);
+
+// time spawning and despawning instances of a template
+extern void BenchmarkSpawn(unsigned int aTemplateId, int aCount);
@@ -0,0 +1,142 @@
+#include "StdAfx.h"
+
+#include "GameState.h"
+#include "PerfTimer.h"
+#include "Journal.h"
+#include "Digest.h"
+
+// maximum turns to run headless
+// (0 runs until playback runs out of turns)
+int HEADLESS_TURNS = 0;
+
+// template to benchmark spawning after the level loads
+// (0 for none; set by benchmarkspawn on the command line)
+unsigned int HEADLESS_BENCHMARK_SPAWN = 0;
+int HEADLESS_BENCHMARK_COUNT = 1000;
+
+// enter and exit the play state
+extern void EnterPlayState();
+extern void ExitPlayState();
+
+namespace Headless
+{
+	// skip a component that only draws
+	static void SkipConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
+	{
+	}
+
+	// seconds for a timer
+	static double Seconds(PerfTimer &aTimer)
+	{
+		return double(aTimer.Ticks()) / double(PerfTimer::mFrequency);
+	}
+}
+
+// run the play state without a window, rendering, or audio
+int RunHeadless(void)
+{
+	// report to standard error
+	DEBUGPRINT_OUTPUTSTDERR = true;
+
+	// without a context, components that create GL objects configure nothing
+	// (sound components too, since there is no audio device)
+	Database::Loader::Configure drawlistconfigure(0xc98b019b /* "drawlist" */, Headless::SkipConfigure);
+	Database::Loader::Configure dynamicdrawlistconfigure(0xdf3cf9c0 /* "dynamicdrawlist" */, Headless::SkipConfigure);
+	Database::Loader::Configure textureconfigure(0x3c6468f4 /* "texture" */, Headless::SkipConfigure);
+	Database::Loader::Configure fogconfigure(0xa1f3723f /* "fog" */, Headless::SkipConfigure);
+	Database::Loader::Configure soundsystemconfigure(0x01ba332d /* "soundsystem" */, Headless::SkipConfigure);
+	Database::Loader::Configure soundconfigure(0x0e0d9594 /* "sound" */, Headless::SkipConfigure);
+	Database::Loader::Configure soundcueconfigure(0xf23cbd5f /* "soundcue" */, Headless::SkipConfigure);
+	Database::Loader::Configure musicconfigure(0x9f9c4fd4 /* "music" */, Headless::SkipConfigure);
+
+	// enter the play state
+	curgamestate = setgamestate = STATE_PLAY;
+	EnterPlayState();
+	if (setgamestate != STATE_PLAY)
+	{
+		DebugPrint("headless: error loading level \"%s\"\n", LEVEL_CONFIG.c_str());
+		ExitPlayState();
+		return 1;
+	}
+
+	// run the spawn benchmark instead of simulating if requested
+	// (its instances would throw off any playback that followed)
+	if (HEADLESS_BENCHMARK_SPAWN)
+	{
+		BenchmarkSpawn(HEADLESS_BENCHMARK_SPAWN, HEADLESS_BENCHMARK_COUNT);
+		ExitPlayState();
+		curgamestate = setgamestate = STATE_NONE;
+		return 0;
+	}
+
+	// open the input journal
+	// (recording makes no sense without live input)
+	if (playback)
+	{
+		OpenJournal();
+		if (!journal.IsPlaying())
+		{
+			ExitPlayState();
+			return 1;
+		}
+	}
+	else if (HEADLESS_TURNS <= 0)
+	{
+		DebugPrint("headless: no playback and no turn count; nothing to run\n");
+		ExitPlayState();
+		return 1;
+	}
+
+	// phase timers
+	// (accumulate over the whole run)
+	PerfTimer::Init();
+	PerfTimer phase_timer[NUM_SIMULATION_PHASES];
+	PerfTimer total_timer;
+	for (int phase = 0; phase < NUM_SIMULATION_PHASES; ++phase)
+		phase_timer[phase].Clear();
+	total_timer.Clear();
+	Digest::ResetCost();
+
+	// simulate turns as fast as possible
+	// (the fraction is always zero during a turn, as in the windowed loop)
+	sim_fraction = 0.0f;
+	const unsigned int startturn = sim_turn;
+	total_timer.Start();
+	while (HEADLESS_TURNS <= 0 || sim_turn - startturn < static_cast<unsigned int>(HEADLESS_TURNS))
+	{
+		if (!SimulateTurn(phase_timer))
+			break;
+	}
+	total_timer.Stop();
+	sim_fraction = 1.0f;
+
+	journal.Close();
+
+	// report turns per second and phase timings
+	const unsigned int turns = sim_turn - startturn;
+	const double total = Headless::Seconds(total_timer);
+	static const char * const phasename[NUM_SIMULATION_PHASES] = { "control", "simulate", "collide", "update" };
+	DebugPrint("headless: %u turns in %.3fs (%.1f turns/s)\n", turns, total, total > 0 ? turns / total : 0.0);
+	for (int phase = 0; phase < NUM_SIMULATION_PHASES; ++phase)
+	{
+		const double seconds = Headless::Seconds(phase_timer[phase]);
+		DebugPrint("  %-8s %.3fs (%.1fus/turn, %.1f%%)\n",
+			phasename[phase], seconds, turns ? 1000000.0 * seconds / turns : 0.0, total > 0 ? 100.0 * seconds / total : 0.0);
+	}
+
+	// report what checking digests cost
+	// (on top of the phase timings above, since digests follow the turn)
+	if (const unsigned int digests = Digest::GetCostCount())
+	{
+		const double seconds = Digest::GetCostSeconds();
+		DebugPrint("  %-8s %.3fs (%u digests, %.1fus each, %.1f%%)\n",
+			"digest", seconds, digests, 1000000.0 * seconds / digests, total > 0 ? 100.0 * seconds / total : 0.0);
+	}
+
+	// exit the play state
+	ExitPlayState();
+	curgamestate = setgamestate = STATE_NONE;
+
+	// fail if playback diverged from the recording
+	return journal.HasDiverged() ? 2 : 0;
+}
@@ -12,6 +12,7 @@
 #include "Escape.h"
 #include "Library.h"
 #include "Font.h"
+#include "Worker.h"
 
 
 bool InitInput(const char *config)
@@ -181,7 +182,8 @@ bool InitLevel(const char *config)
 	reticule_handle = 0;
 
 	// show the mouse cursor
-	Platform::ShowCursor(true);
+	if (!headless)
+		Platform::ShowCursor(true);
 
 	return false;
 
@@ -196,6 +198,10 @@ void PlayerJoinListener(unsigned int aId)
 	Database::playercamera.Put(aId, playercamera);
 	playercamera->Activate();
 
+	// headless runs draw nothing
+	if (headless)
+		return;
+
 	// create player hud overlay
 	// (creates game-specific components)
 	PlayerHUD *playerhud = new PlayerHUD(aId);
@@ -226,22 +232,26 @@ void PlayerQuitListener(unsigned int aId)
 // enter play state
 void EnterPlayState()
 {
-	// set up drawlists
-	InitDrawlists();
+	// if drawing...
+	if (!headless)
+	{
+		// set up drawlists
+		InitDrawlists();
 
-	// create default font
-	CreateDefaultFont();
+		// create default font
+		CreateDefaultFont();
 
-	// clear the screen
-	glClear(
-		GL_COLOR_BUFFER_BIT
+		// clear the screen
+		glClear(
+			GL_COLOR_BUFFER_BIT
 #ifdef ENABLE_DEPTH_TEST
-		| GL_DEPTH_BUFFER_BIT
+			| GL_DEPTH_BUFFER_BIT
 #endif
-		);
+			);
 
-	// show back buffer
-	Platform::Present();
+		// show back buffer
+		Platform::Present();
+	}
 
 	// reset camera position
 	camerapos[0] = camerapos[1] = Vector2(0, 0);
@@ -270,11 +280,15 @@ void EnterPlayState()
 	Database::overlay.Put(0x9e212406 /* "escape" */, escape);
 	escape->SetAction(Overlay::Action(RenderEscapeOptions));
 
-	// start audio
-	Sound::Resume();
+	// if playing audio...
+	if (!headless)
+	{
+		// start audio
+		Sound::Resume();
 
-	// play the startup sound (HACK)
-	PlaySoundCue(0x94326baa /* "startup" */);
+		// play the startup sound (HACK)
+		PlaySoundCue(0x94326baa /* "startup" */);
+	}
 
 	// set to runtime mode
 	runtime = true;
@@ -288,21 +302,29 @@ void ExitPlayState()
 {
 	DebugPrint("Quitting...\n");
 
-	// stop audio
-	Sound::Pause();
+	// if playing audio...
+	if (!headless)
+	{
+		// stop audio
+		Sound::Pause();
 
-	// stop any startup sound (HACK)
-	StopSoundCue(0x94326baa /* "startup" */);
+		// stop any startup sound (HACK)
+		StopSoundCue(0x94326baa /* "startup" */);
+	}
 
 	// delete escape overlay
 	delete Database::overlay.Get(0x9e212406 /* "escape" */);
 	Database::overlay.Delete(0x9e212406 /* "escape" */);
 
-	// cleanup drawlists
-	CleanupDrawlists();
+	// if drawing...
+	if (!headless)
+	{
+		// cleanup drawlists
+		CleanupDrawlists();
 
-	// cleanup textures
-	CleanupTextures();
+		// cleanup textures
+		CleanupTextures();
+	}
 
 	// clear all databases
 	Database::Cleanup();
@@ -313,6 +335,9 @@ void ExitPlayState()
 	// remove the quit listener
 	Player::sQuit.Disconnect(PlayerQuitListener);
 
+	// stop worker threads
+	Worker::Done();
+
 	// collidable done
 	Collidable::WorldDone();
 
@@ -10,6 +10,7 @@
 #include "Points.h"
 #include "PointsOverlay.h"
 #include "Sound.h"
+#include "Snapshot.h"
 
 #include "Ship.h"
 #include "Resource.h"
@@ -30,6 +31,20 @@ namespace Database
 		Configure playerconfigure(0x2c99c300 /* "player" */, PlayerConfigure);
 	}
 
+	namespace Serializer
+	{
+		static void PlayerSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::player.Get(aId)->Save(aWriter);
+		}
+		static void PlayerRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Player *player = Database::player.Get(aId))
+				player->Restore(aReader);
+		}
+		Snapshot::Serializer::Custom playerserializer(0x2c99c300 /* "player" */, PlayerSave, PlayerRestore);
+	}
+
 	namespace Initializer
 	{
 		static void PlayerActivate(unsigned int aId)
@@ -113,7 +128,9 @@ Player::Player(const PlayerTemplate &aTemplate, unsigned int aId)
 	SetAction(Action(this, &Player::Update));
 
 	// notify join listeners
-	sJoin(mId);
+	// (unless a snapshot restore is only reactivating the player)
+	if (!Snapshot::IsRestoringInPlace(mId))
+		sJoin(mId);
 
 	{
 		// add a kill listener
@@ -159,7 +176,26 @@ Player::~Player(void)
 	}
 
 	// notify leave listeners
-	sQuit(mId);
+	// (unless a snapshot restore is only reactivating the player)
+	if (!Snapshot::IsRestoringInPlace(mId))
+		sQuit(mId);
+}
+
+// save snapshot state
+// (the attached entity reattaches as its player controller activates)
+void Player::Save(Snapshot::Writer &aWriter) const
+{
+	aWriter.Write(mTimer);
+	aWriter.Write(mLives);
+	aWriter.Write(mScore);
+}
+
+// restore snapshot state
+void Player::Restore(Snapshot::Reader &aReader)
+{
+	aReader.Read(mTimer);
+	aReader.Read(mLives);
+	aReader.Read(mScore);
 }
 
 // player update
@@ -25,6 +25,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element, unsigned int aId);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 // player
 class GAME_API Player : public Updatable
 {
@@ -50,6 +56,10 @@ public:
 	// update
 	void Update(float aStep);
 
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
+
 	// spawn
 	unsigned int Spawn(void);
 
@@ -4,6 +4,7 @@
 #include "Texture.h"
 #include "Interpolator.h"
 #include "Noise.h"
+#include "Profiler.h"
 
 #include "Expression.h"
 #include "ExpressionConfigure.h"
@@ -143,7 +144,7 @@ namespace Database
 
 		static void VariableConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
 		{
-			Typed<float> &variables = Database::variable.Open(aId);
+			Variables &variables = Database::variable.Open(aId);
 
 			unsigned int name = Hash(element->Attribute("name"));
 			unsigned int type = Hash(element->Attribute("type"));
@@ -151,6 +152,8 @@ namespace Database
 			const char * const *names;
 			const float *data;
 			GetTypeData(type, width, names, data);
+			if (width <= 4)
+				Variables::Register(name, width);
 			for (int i = 0; i < width; i++)
 			{
 				float value = data[i];
@@ -1240,6 +1243,8 @@ void RebuildDrawlists(void)
 
 void RenderDrawlist(unsigned int aId, float aTime, const Transform2 &aTransform)
 {
+	PROFILE_ZONE("RenderDrawlist");
+
 	// skip if not visible
 	if (aTime < 0)
 		return;
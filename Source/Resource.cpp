@@ -4,6 +4,8 @@
 #include "Updatable.h"
 #include "Link.h"
 #include "ExpressionAction.h"
+#include "Digest.h"
+#include "Snapshot.h"
 
 
 #ifdef USE_POOL_ALLOCATOR
@@ -28,6 +30,44 @@ namespace Database
 	Typed<Typed<Resource::EmptySignal> > resourceempty(0xc5325c82 /* "resourceempty" */);
 	Typed<Typed<Resource::FullSignal> > resourcefull(0xa4f2734c /* "resourcefull" */);
 
+	namespace Serializer
+	{
+		static void ResourceSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			const Typed<Resource *> &resources = Database::resource.Get(aId);
+			aWriter.Write(static_cast<unsigned int>(resources.GetCount()));
+			for (Typed<Resource *>::Iterator itor(&resources); itor.IsValid(); ++itor)
+			{
+				aWriter.Write(itor.GetKey());
+				itor.GetValue()->Save(aWriter);
+			}
+		}
+		static void ResourceRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			const Typed<Resource *> &resources = Database::resource.Get(aId);
+			unsigned int count = 0;
+			aReader.Read(count);
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				Key aSubId;
+				if (!aReader.Read(aSubId))
+					break;
+				if (Resource *resource = resources.Get(aSubId))
+				{
+					resource->Restore(aReader);
+				}
+				else
+				{
+					// skip a resource the template no longer has
+					float value, timer;
+					aReader.Read(value);
+					aReader.Read(timer);
+				}
+			}
+		}
+		Snapshot::Serializer::Custom resourceserializer(0x29df7ff5 /* "resource" */, ResourceSave, ResourceRestore);
+	}
+
 	namespace Loader
 	{
 		static void ResourceConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
@@ -72,6 +112,26 @@ namespace Database
 		}
 		Deactivate resourcedeactivate(0x79aa609b /* "resourcetemplate" */, ResourceDeactivate);
 	}
+
+	namespace Digest
+	{
+		static unsigned int ResourceHash(void)
+		{
+			unsigned int sum = 0;
+			for (Typed<Typed<Resource *> >::Iterator outer(&Database::resource); outer.IsValid(); ++outer)
+			{
+				for (Typed<Resource *>::Iterator itor(&outer.GetValue()); itor.IsValid(); ++itor)
+				{
+					::Digest::Hasher hasher(outer.GetKey());
+					hasher.Add(itor.GetKey());
+					hasher.Add(itor.GetValue()->GetValue());
+					sum += hasher.Finish();
+				}
+			}
+			return sum;
+		}
+		::Digest::Section resourcesection(0x29df7ff5 /* "resource" */, "resource", ResourceHash);
+	}
 }
 
 
@@ -161,6 +221,28 @@ void Resource::Update(float aStep)
 	}
 }
 
+// save snapshot state
+void Resource::Save(Snapshot::Writer &aWriter) const
+{
+	aWriter.Write(mValue);
+	aWriter.Write(mTimer);
+}
+
+// restore snapshot state
+void Resource::Restore(Snapshot::Reader &aReader)
+{
+	aReader.Read(mValue);
+	aReader.Read(mTimer);
+
+	// recover or decay only while short of the limit, as Set does
+	const ResourceTemplate &resource = Database::resourcetemplate.Get(mId).Get(mSubId);
+	if (resource.mAdd > 0 && mValue < resource.mMaximum ||
+		resource.mAdd < 0 && mValue > 0)
+		Activate();
+	else
+		Deactivate();
+}
+
 void Resource::Set(unsigned int aSourceId, float aValue)
 {
 	const ResourceTemplate &resource = Database::resourcetemplate.Get(mId).Get(mSubId);
@@ -33,6 +33,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element, unsigned int aId, unsigned int aSubId);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 class GAME_API Resource : public Updatable
 {
 protected:
@@ -61,6 +67,10 @@ public:
 
 	void Update(float aStep);
 
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
+
 	float GetValue(void) const
 	{
 		return mValue;
@@ -13,6 +13,9 @@
 #include "Sound.h"
 #include "Font.h"
 #include "Texture.h"
+#include "PerfTimer.h"
+#include "Profiler.h"
+#include "Journal.h"
 
 #include "Console.h"
 
@@ -33,6 +36,10 @@ int SIMULATION_RATE = 60;
 float TIME_SCALE = 1.0f;
 bool FIXED_STEP = false;
 
+// worker threads for the control phase
+// (zero controls everything on the main thread)
+int CONTROL_THREADS = 0;
+
 // rendering attributes
 int MOTIONBLUR_STEPS = 1;
 float MOTIONBLUR_TIME = 1.0f/60.0f;
@@ -45,12 +52,21 @@ bool PROFILER_OUTPUTPRINT = false;
 bool FRAMERATE_OUTPUTSCREEN = false;
 bool FRAMERATE_OUTPUTPRINT = false;
 
+// database statistics
+bool DATABASE_OUTPUTSCREEN = false;
+
+// render statistics
+bool RENDER_OUTPUTSCREEN = false;
+
 // debug draw
 bool DEBUG_DRAW = false;
 
 // input system
 Input input;
 
+// input journal
+Journal journal;
+
 // frame values (HACK)
 float frame_time;
 float frame_turns;
@@ -82,10 +98,16 @@ bool escape = false;
 #define DRAW_PERFORMANCE_DETAILS
 #define PRINT_PERFORMANCE_FRAMERATE
 #define DRAW_PERFORMANCE_FRAMERATE
+#define DRAW_DATABASE_STATISTICS
 //#define PRINT_SIMULATION_TIMER
 //#define USE_ACCUMULATION_BUFFER
-#ifdef GET_PERFORMANCE_DETAILS
-#include "PerfTimer.h"
+
+#if defined(DRAW_DATABASE_STATISTICS)
+// order databases by lookup count
+static bool DatabaseBusiestFirst(const Database::Untyped *aA, const Database::Untyped *aB)
+{
+	return aA->GetLookupCount() > aB->GetLookupCount();
+}
 #endif
 
 static void Pause(void)
@@ -457,6 +479,156 @@ static void ReadInput()
 #endif
 }
 
+// simulate one turn
+// (shared by the windowed loop and the headless runner so both produce the same turns;
+// returns false when playback runs out of turns)
+bool SimulateTurn(PerfTimer aPhaseTimer[NUM_SIMULATION_PHASES])
+{
+	// advance the profiler capture
+	Profiler::Turn();
+	PROFILE_ZONE("SimulateTurn");
+
+	// record a keyframe if one is due
+	if (curgamestate == STATE_PLAY && journal.IsRecording())
+		journal.RecordKeyframe(sim_turn, input);
+
+	// advance the turn counter
+	++sim_turn;
+
+	// report database statistics for the previous turn
+	Database::Statistics::Update(sim_turn - 1);
+
+	// seed the random number generator
+	Random::Seed(0x92D68CA2 ^ sim_turn);
+	(void)Random::Int();
+
+	// update database
+	Database::Update();
+
+	if (curgamestate == STATE_PLAY)
+	{
+		if (journal.IsPlaying())
+		{
+			// update the control values
+			// (quit if out of turns)
+			if (!journal.Playback(sim_turn, input))
+				return false;
+		}
+		else if (journal.IsRecording())
+		{
+			// save original input values
+			float prev[Input::NUM_LOGICAL];
+			memcpy(prev, input.output, sizeof(prev));
+
+			// update input values
+			input.Update();
+
+			// record changed control values
+			journal.Record(sim_turn, prev, input);
+		}
+		else
+		{
+			// update input values
+			input.Update();
+		}
+	}
+
+	// do any pending turn actions
+	DoTurn();
+
+
+	// CONTROL PHASE
+
+	if (aPhaseTimer)
+		aPhaseTimer[SIMULATION_PHASE_CONTROL].Start();
+
+	// control all entities
+	Controller::ControlAll(sim_step);
+
+	if (aPhaseTimer)
+	{
+		aPhaseTimer[SIMULATION_PHASE_CONTROL].Stop();
+		aPhaseTimer[SIMULATION_PHASE_SIMULATE].Start();
+	}
+
+	// SIMULATION PHASE
+	// (generate forces)
+	Simulatable::SimulateAll(sim_step);
+
+	if (aPhaseTimer)
+	{
+		aPhaseTimer[SIMULATION_PHASE_SIMULATE].Stop();
+		aPhaseTimer[SIMULATION_PHASE_COLLIDE].Start();
+	}
+
+	// COLLISION PHASE
+	// (apply forces and update positions)
+	Collidable::CollideAll(sim_step);
+
+	if (aPhaseTimer)
+	{
+		aPhaseTimer[SIMULATION_PHASE_COLLIDE].Stop();
+		aPhaseTimer[SIMULATION_PHASE_UPDATE].Start();
+	}
+
+	// UPDATE PHASE
+	// (use updated positions)
+	Updatable::UpdateAll(sim_step);
+
+	if (aPhaseTimer)
+		aPhaseTimer[SIMULATION_PHASE_UPDATE].Stop();
+
+	// hash the world state
+	// (recorded when enabled, and checked against the recording during playback)
+	if (curgamestate == STATE_PLAY)
+	{
+		if (journal.IsPlaying())
+			journal.CheckDigest(sim_turn);
+		else if (journal.IsRecording() && JOURNAL_DIGEST)
+			journal.RecordDigest(sim_turn);
+	}
+
+	// step inputs for next turn
+	input.Step();
+
+	return true;
+}
+
+// open the input journal for the play state
+void OpenJournal(void)
+{
+	if (playback)
+		journal.OpenPlayback(RECORD_CONFIG.c_str());
+	else if (record)
+		journal.OpenRecord(RECORD_CONFIG.c_str());
+}
+
+// seek playback to a turn
+bool SeekTurn(unsigned int aTurn)
+{
+	if (!journal.IsPlaying())
+		return false;
+
+	// restore the nearest keyframe if going backward or if it skips ahead
+	unsigned int keyframe = 0;
+	const bool haskeyframe = journal.FindKeyframe(aTurn, keyframe);
+	if (aTurn < sim_turn || (haskeyframe && keyframe > sim_turn))
+	{
+		if (!haskeyframe || !journal.SeekKeyframe(aTurn, input))
+			return false;
+	}
+
+	// simulate forward to the turn
+	// (in simulation mode, as in the run loop)
+	const float save_fraction = sim_fraction;
+	sim_fraction = 0.0f;
+	while (sim_turn < aTurn && SimulateTurn(NULL))
+		continue;
+	sim_fraction = save_fraction;
+
+	return sim_turn == aTurn;
+}
+
 // common run state
 void RunState()
 {
@@ -473,34 +645,18 @@ void RunState()
 	double prevtime = glfwGetTime();
 #endif
 
-	// input logging
-	tinyxml2::XMLDocument inputlog;
-	tinyxml2::XMLElement *inputlogroot = NULL;
-	tinyxml2::XMLElement *inputlognext = NULL;
+	// input journal
 	if (curgamestate == STATE_PLAY)
-	{
-		if (playback)
-		{
-			if (inputlog.LoadFile(RECORD_CONFIG.c_str()) != tinyxml2::XML_SUCCESS)
-				DebugPrint("error loading recording file \"%s\": %s %s\n", RECORD_CONFIG.c_str(), inputlog.GetErrorStr1(), inputlog.GetErrorStr2());
-			inputlogroot = inputlog.RootElement();
-			inputlognext = inputlogroot->FirstChildElement();
-		}
-		else if (record)
-		{
-			inputlogroot = inputlog.NewElement("journal");
-			inputlog.LinkEndChild(inputlogroot);
-			inputlognext = NULL;
-		}
-	}
+		OpenJournal();
 
 #ifdef GET_PERFORMANCE_DETAILS
 	PerfTimer::Init();
 
-	PerfTimer control_timer;
-	PerfTimer simulate_timer;
-	PerfTimer collide_timer;
-	PerfTimer update_timer;
+	PerfTimer phase_timer[NUM_SIMULATION_PHASES];
+	PerfTimer &control_timer = phase_timer[SIMULATION_PHASE_CONTROL];
+	PerfTimer &simulate_timer = phase_timer[SIMULATION_PHASE_SIMULATE];
+	PerfTimer &collide_timer = phase_timer[SIMULATION_PHASE_COLLIDE];
+	PerfTimer &update_timer = phase_timer[SIMULATION_PHASE_UPDATE];
 	PerfTimer render_timer;
 	PerfTimer overlay_timer;
 	PerfTimer display_timer;
@@ -645,9 +801,6 @@ void RunState()
 				// deduct a turn
 				sim_fraction -= 1.0f;
 				
-				// advance the turn counter
-				++sim_turn;
-
 				// save original fraction
 				float save_fraction = sim_fraction;
 
@@ -659,125 +812,17 @@ void RunState()
 				glNewList(debugdraw, GL_COMPILE);
 #endif
 
-				// seed the random number generator
-				Random::Seed(0x92D68CA2 ^ sim_turn);
-				(void)Random::Int();
-
-				// update database
-				Database::Update();
-
-				if (curgamestate == STATE_PLAY)
-				{
-					if (playback)
-					{
-						// quit if out of turns
-						if (!inputlognext)
-						{
-							setgamestate = STATE_SHELL;
-							break;
-						}
-
-						// get the next turn value
-						int turn = -1;
-						inputlognext->QueryIntAttribute("turn", &turn);
-
-						// if the turn matches the simulation turn...
-						if ((unsigned int)turn == sim_turn)
-						{
-							// update the control values
-							input.Playback(inputlognext);
-
-							// go to the next entry
-							inputlognext = inputlognext->NextSiblingElement();
-						}
-					}
-					else if (record)
-					{
-						// save original input values
-						float prev[Input::NUM_LOGICAL];
-						memcpy(prev, input.output, sizeof(prev));
-
-						// update input values
-						input.Update();
-
-						// if any controls have changed...
-						bool changed = false;
-						for (int i = 0; i < Input::NUM_LOGICAL; ++i)
-						{
-							if (input.output[i] != prev[i])
-							{
-								changed = true; break;
-							}
-						}
-						if (changed)
-						{
-							// create an input turn entry
-							tinyxml2::XMLElement *item = inputlog.NewElement("input");
-							item->SetAttribute( "turn", sim_turn );
-
-							// add changed control values
-							input.Record(item, prev);
-
-							// add the new input entry
-							inputlogroot->InsertEndChild(item);
-						}
-					}
-					else
-					{
-						// update input values
-						input.Update();
-					}
-				}
-
-				// do any pending turn actions
-				DoTurn();
-
-
-				// CONTROL PHASE
-
-#ifdef GET_PERFORMANCE_DETAILS
-				control_timer.Start();
-#endif
-
-				// control all entities
-				Controller::ControlAll(sim_step);
-
-#ifdef GET_PERFORMANCE_DETAILS
-				control_timer.Stop();
-
-				simulate_timer.Start();
-#endif
-
-				// SIMULATION PHASE
-				// (generate forces)
-				Simulatable::SimulateAll(sim_step);
-
-#ifdef GET_PERFORMANCE_DETAILS
-				simulate_timer.Stop();
-
-				collide_timer.Start();
-#endif
-
-				// COLLISION PHASE
-				// (apply forces and update positions)
-				Collidable::CollideAll(sim_step);
-
+				// simulate the turn
+				// (quit if out of turns)
 #ifdef GET_PERFORMANCE_DETAILS
-				collide_timer.Stop();
-
-				update_timer.Start();
-#endif
-
-				// UPDATE PHASE
-				// (use updated positions)
-				Updatable::UpdateAll(sim_step);
-
-#ifdef GET_PERFORMANCE_DETAILS
-				update_timer.Stop();
+				if (!SimulateTurn(phase_timer))
+#else
+				if (!SimulateTurn(NULL))
 #endif
-
-				// step inputs for next turn
-				input.Step();
+				{
+					setgamestate = STATE_SHELL;
+					break;
+				}
 
 #ifdef COLLECT_DEBUG_DRAW
 				// finish the draw list
@@ -823,6 +868,8 @@ void RunState()
 
 			// render all entities
 			// (send interpolation ratio and offset from simulation time)
+			// TO DO: render from a snapshot the simulation publishes each turn, on its own thread
+			// (drawlists still read and write variables on live entities, and the GL context belongs to this thread)
 			Renderable::RenderAll(view);
 
 			// reset camera transform
@@ -1092,6 +1139,65 @@ void RunState()
 #endif
 #endif
 
+#if defined(DRAW_DATABASE_STATISTICS)
+		if (DATABASE_OUTPUTSCREEN)
+		{
+			// gather databases with the most lookups
+			std::vector<const Database::Untyped *> databases;
+			for (Database::Typed<Database::Untyped *>::Iterator itor(&Database::GetDatabases()); itor.IsValid(); ++itor)
+				databases.push_back(itor.GetValue());
+			std::sort(databases.begin(), databases.end(), DatabaseBusiestFirst);
+			const size_t rows = std::min<size_t>(databases.size(), 48);
+
+			FontDrawBegin(sDefaultFontHandle);
+
+			char buf[128];
+			FontDrawColor(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+			FontDrawString("database       count/limit stride grow lookups avg max   kbytes", 16, 56, 8, -8, 0);
+
+			int y = 56 + 8;
+			for (size_t i = 0; i < rows; ++i)
+			{
+				const Database::Untyped *database = databases[i];
+
+				// highlight long probes
+				if (database->GetProbeMax() > 8)
+					FontDrawColor(Color4(1.0f, 0.5f, 0.0f, 1.0f));
+				else
+					FontDrawColor(Color4(0.5f, 0.5f, 0.5f, 1.0f));
+
+				sprintf(buf, "0x%08x %7u/%-7u %6u %4u %7u %3.1f %-3u %8.1f",
+					database->GetId(),
+					unsigned(database->GetCount()), unsigned(database->GetLimit()), unsigned(database->GetStride()),
+					unsigned(database->GetGrowCount()), unsigned(database->GetLookupCount()),
+					database->GetProbeAverage(), unsigned(database->GetProbeMax()),
+					database->GetBytes() / 1024.0f);
+				FontDrawString(buf, 16, float(y), 8, -8, 0);
+				y += 8;
+			}
+
+			FontDrawEnd();
+		}
+#endif
+
+		if (RENDER_OUTPUTSCREEN)
+		{
+			// draw renderables drawn, gathered from the grid, and shown
+			const Renderable::Stats &stats = Renderable::GetStats();
+
+			FontDrawBegin(sDefaultFontHandle);
+
+			char buf[64];
+			sprintf(buf, "%u/%u/%u drawn", stats.mDrawn, stats.mCandidates, stats.mShown);
+			FontDrawColor(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+			FontDrawString(buf, float(640 - 16 - 8 * strlen(buf)), 48, 8, -8, 0);
+			sprintf(buf, "%u cells", stats.mCells);
+			FontDrawColor(Color4(0.5f, 0.5f, 0.5f, 1.0f));
+			FontDrawString(buf, float(640 - 16 - 8 * strlen(buf)), 56, 8, -8, 0);
+
+			FontDrawEnd();
+		}
+
 #if defined(DRAW_SOUND_USAGE)
 		if (SOUND_OUTPUTSCREEN)
 		{
@@ -1161,12 +1267,7 @@ void RunState()
 		glDeleteLists(debugdraw, 1);
 #endif
 
-	if (curgamestate == STATE_PLAY)
-	{
-		if (record)
-		{
-			// save input log
-			inputlog.SaveFile(RECORD_CONFIG.c_str());
-		}
-	}
+	// finish the input journal
+	// (recordings are written as they go)
+	journal.Close();
 }
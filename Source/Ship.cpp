@@ -192,7 +192,7 @@ void Ship::Simulate(float aStep)
 			entity->SetVelocity(entity->GetVelocity() + dv);
 
 		// save throttle for the renderer
-		Database::Typed<float> &variables = Database::variable.Open(mId);
+		Database::Variables &variables = Database::variable.Open(mId);
 		variables.Put(0xd0624e33 /* "thrust" */ + 0, mMove.x);
 		variables.Put(0xd0624e33 /* "thrust" */ + 1, mMove.y);
 		variables.Put(0xd0624e33 /* "thrust" */ + 2, 0.0f);
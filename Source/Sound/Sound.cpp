@@ -2,6 +2,7 @@
 #include "Sound.h"
 #include "SoundConfigure.h"
 #include "Entity.h"
+#include "Snapshot.h"
 
 #define DISTANCE_FALLOFF
 #define PROFILE_SOUND_SYNTHESIS
@@ -242,7 +243,10 @@ namespace Database
 
 		static void SoundPostActivate(unsigned int aId)
 		{
-			PlaySoundCue(aId, 0);
+			// play the spawn cue
+			// (unless a snapshot restore is bringing the instance back)
+			if (!Snapshot::IsRestoring())
+				PlaySoundCue(aId, 0);
 		}
 		PostActivate soundpostactivate(0xf23cbd5f /* "soundcue" */, SoundPostActivate);
 
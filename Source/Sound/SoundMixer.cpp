@@ -1,6 +1,7 @@
 #include "StdAfx.h"
 #include "Sound.h"
 #include "SoundMixer.h"
+#include "Profiler.h"
 
 #if defined(USE_SDL) && !defined(USE_SDL_MIXER)
 
@@ -29,6 +30,9 @@ inline float SoftClamp(float x)
 
 void MixSound(void *userdata, unsigned char *stream, int len)
 {
+	// the mixer runs on the audio thread, outside the turn
+	PROFILE_ZONE_ASYNC("MixSound");
+
 	int samples = len / sizeof(short);
 
 	// if no sounds playing...
@@ -3,6 +3,7 @@
 #include "Entity.h"
 #include "Renderable.h"
 #include "Team.h"
+#include "Snapshot.h"
 
 
 #ifdef USE_POOL_ALLOCATOR
@@ -61,6 +62,33 @@ namespace Database
 	Typed<Spawner *> spawner(0x4936726f /* "spawner" */);
 	Typed<SpawnerTracker> spawnertracker(0x9eefed29 /* "spawnertracker" */);
 
+	namespace Serializer
+	{
+		static void SpawnerSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::spawner.Get(aId)->Save(aWriter);
+		}
+		static void SpawnerRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Spawner *spawner = Database::spawner.Get(aId))
+				spawner->Restore(aReader);
+		}
+		Snapshot::Serializer::Custom spawnerserializer(0x4936726f /* "spawner" */, SpawnerSave, SpawnerRestore);
+
+		// trackers are put again so they count against their spawner
+		static void SpawnerTrackerSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			aWriter.Write(Database::spawnertracker.Get(aId).mId);
+		}
+		static void SpawnerTrackerRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			unsigned int aSpawnerId = 0;
+			if (aReader.Read(aSpawnerId))
+				Database::spawnertracker.Put(aId, SpawnerTracker(aSpawnerId));
+		}
+		Snapshot::Serializer::Custom spawnertrackerserializer(0x9eefed29 /* "spawnertracker" */, SpawnerTrackerSave, SpawnerTrackerRestore);
+	}
+
 	namespace Loader
 	{
 		static void SpawnerConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
@@ -208,6 +236,19 @@ Spawner::~Spawner(void)
 {
 }
 
+// save snapshot state
+// (the tracking count is rebuilt as trackers are restored)
+void Spawner::Save(Snapshot::Writer &aWriter) const
+{
+	aWriter.Write(mTimer);
+}
+
+// restore snapshot state
+void Spawner::Restore(Snapshot::Reader &aReader)
+{
+	aReader.Read(mTimer);
+}
+
 // spawner update
 void Spawner::Update(float aStep)
 {
@@ -221,13 +262,24 @@ void Spawner::Update(float aStep)
 	// advance the timer
 	mTimer += aStep;
 
+	// reserve database capacity for this update's spawns
+	// (each spawn still activates right after it gets placed,
+	// so random values get drawn in the same order as before)
+	if (mTimer > 0.0f && spawner.mCycle > 0.0f)
+	{
+		size_t count = size_t(ceilf(mTimer / spawner.mCycle));
+		if (spawner.mTrack && count > size_t(spawner.mTrack - mTrack))
+			count = size_t(spawner.mTrack - mTrack);
+		Database::ReserveBatch(spawner.mSpawn, count);
+	}
+
 	// if the timer elapses...
 	while (mTimer > 0.0f)
 	{
 		// get the spawner entity
 		Entity *entity = Database::entity.Get(mId);
 		if (!entity)
-			return;
+			break;
 
 		// TO DO: consolidate this with similar spawn patterns (Graze, Weapon)
 
@@ -273,31 +325,8 @@ void Spawner::Update(float aStep)
 		transform.a += velocity.a * (aStep - mTimer);
 		transform.p += velocity.p * (aStep - mTimer);
 
-		// instantiate the spawn entity
-		if (unsigned int spawnId = Database::Instantiate(spawner.mSpawn, Database::owner.Get(mId), mId, transform.a, transform.p, velocity.p, velocity.a, false))
-		{
-			// if the spawner has a team...
-			unsigned int team = Database::team.Get(mId);
-			if (team)
-			{
-				// propagate team to spawned item
-				Database::team.Put(spawnId, team);
-			}
-
-			// activate
-			Database::Activate(spawnId);
-
-			// set fractional turn
-			if (Renderable *renderable = Database::renderable.Get(spawnId))
-				renderable->SetFraction(mTimer / aStep);
-
-			// if tracking....
-			if (spawner.mTrack)
-			{
-				// add a tracker
-				Database::spawnertracker.Put(spawnId, SpawnerTracker(mId));
-			}
-		}
+		// spawn the entity
+		Spawn(spawner, transform, velocity, mTimer / aStep);
 
 		// set the timer
 		mTimer -= spawner.mCycle;
@@ -311,3 +340,33 @@ void Spawner::Update(float aStep)
 		}
 	}
 }
+
+// spawn an entity
+void Spawner::Spawn(const SpawnerTemplate &aTemplate, const Transform2 &aTransform, const Transform2 &aVelocity, float aFraction)
+{
+	// instantiate the spawn entity
+	if (unsigned int spawnId = Database::Instantiate(aTemplate.mSpawn, Database::owner.Get(mId), mId, aTransform.a, aTransform.p, aVelocity.p, aVelocity.a, false))
+	{
+		// if the spawner has a team...
+		unsigned int team = Database::team.Get(mId);
+		if (team)
+		{
+			// propagate team to spawned item
+			Database::team.Put(spawnId, team);
+		}
+
+		// activate
+		Database::Activate(spawnId);
+
+		// set fractional turn
+		if (Renderable *renderable = Database::renderable.Get(spawnId))
+			renderable->SetFraction(aFraction);
+
+		// if tracking....
+		if (aTemplate.mTrack)
+		{
+			// add a tracker
+			Database::spawnertracker.Put(spawnId, SpawnerTracker(mId));
+		}
+	}
+}
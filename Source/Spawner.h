@@ -27,6 +27,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 class Spawner
 	: public Updatable
 {
@@ -48,7 +54,14 @@ public:
 	// update
 	void Update(float aStep);
 
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
+
 protected:
+	// spawn an entity
+	void Spawn(const SpawnerTemplate &aTemplate, const Transform2 &aTransform, const Transform2 &aVelocity, float aFraction);
+
 	friend class SpawnerTracker;
 
 	// tracking
@@ -0,0 +1,560 @@
+#include "StdAfx.h"
+#include "TargetIndex.h"
+#include "Damagable.h"
+#include "Cancelable.h"
+#include "Team.h"
+#include "Profiler.h"
+
+#include <mutex>
+#include <atomic>
+
+namespace TargetIndex
+{
+	// grid cell size in world units
+	static const float GRID_CELL_SIZE = 64.0f;
+
+	// maximum grid cells along each axis
+	// (targets spread wider than this get larger cells)
+	static const int GRID_MAX_CELLS = 128;
+
+	// team and category partition
+	// (targets register in the cell holding their center, and targets larger than a cell
+	// go after the gridded ones where every query checks them)
+	struct Partition
+	{
+		unsigned int mTeam;
+		unsigned int mCategories;				// target categories
+		float mReach;							// largest bounding radius of a gridded target
+		std::vector<unsigned int> mCellStart;	// first slot of each cell, then the slot count
+		unsigned int mLarge;					// first slot of the large targets
+		std::vector<Target> mTargets;			// targets by slot
+
+		// bounding circles by slot
+		// (separate arrays so the distance test loads four at a time)
+		std::vector<float> mX;
+		std::vector<float> mY;
+		std::vector<float> mRadius;
+	};
+
+	// grid slots of each target entity
+	// (sorted by identifier so removals find them without a scan)
+	struct SlotRef
+	{
+		unsigned int mId;
+		unsigned int mPartition;
+		unsigned int mSlot;
+	};
+
+	// gathered target with its bounding circle
+	struct Candidate
+	{
+		Target mTarget;
+		float mRadius;
+		unsigned int mPartition;
+		int mCell;
+	};
+
+	// indexed shape set
+	struct Index
+	{
+		// grid shared by all partitions
+		Vector2 mOrigin;
+		float mScale;
+		int mWidth;
+		int mHeight;
+		std::vector<Partition> mPartitions;
+
+		// physics world revision the index was built from
+		// (zero until the first build)
+		std::atomic<unsigned int> mRevision;
+
+		// grid slots of each target entity
+		std::vector<SlotRef> mSlotRefs;
+
+		// bodies added since the build, gathered by the next query
+		std::vector<unsigned int> mPending;
+		std::atomic<bool> mHasPending;
+
+		// targets added since the build
+		// (every query checks them)
+		std::vector<Candidate> mExtra;
+	};
+	static Index sIndex[NUM_SETS];
+
+	// builds and gathers share scratch space
+	static std::mutex sBuildMutex;
+	static std::vector<Candidate> sCandidates;
+	static std::vector<unsigned int> sCursor;
+
+	// query hit
+	struct Hit
+	{
+		size_t mQuery;
+		Target mTarget;
+		float mRange;
+		Vector2 mPoint;
+	};
+
+	static bool CompareSlotRefs(const SlotRef &aRef1, const SlotRef &aRef2)
+	{
+		return aRef1.mId < aRef2.mId;
+	}
+
+	// get a cell index along an axis
+	// (clamped to the grid, with anything not finite going to the first cell)
+	static inline int GetCellIndex(float aValue, int aLimit)
+	{
+		if (!(aValue > 0.0f))
+			return 0;
+		if (aValue >= float(aLimit - 1))
+			return aLimit - 1;
+		return int(aValue);
+	}
+
+	// get the partition for a team and categories
+	static unsigned int GetPartition(Index &aIndex, unsigned int aTeam, unsigned int aCategories)
+	{
+		for (unsigned int i = 0; i < aIndex.mPartitions.size(); ++i)
+		{
+			if (aIndex.mPartitions[i].mTeam == aTeam && aIndex.mPartitions[i].mCategories == aCategories)
+				return i;
+		}
+		aIndex.mPartitions.push_back(Partition());
+		Partition &partition = aIndex.mPartitions.back();
+		partition.mTeam = aTeam;
+		partition.mCategories = aCategories;
+		return static_cast<unsigned int>(aIndex.mPartitions.size() - 1);
+	}
+
+	// gathers the shapes of one entity
+	class Gather
+	{
+	public:
+		Index *mIndex;
+		unsigned int mId;
+		unsigned int mTeam;
+
+	public:
+		void Add(CollidableShape *aShape)
+		{
+			// sensors are never targets
+			if (Collidable::IsSensor(aShape))
+				return;
+
+			// bounding circle around the bounding box
+			// (padded so rounding never rejects a shape the exact test accepts)
+			const AlignedBox2 box(Collidable::GetBounds(aShape));
+			const Vector2 size(box.max - box.min);
+
+			Candidate candidate;
+			candidate.mTarget.mId = mId;
+			candidate.mTarget.mTeam = mTeam;
+			candidate.mTarget.mFilter = Collidable::GetFilter(aShape);
+			candidate.mTarget.mShape = aShape;
+			candidate.mTarget.mCenter = (box.min + box.max) * 0.5f;
+			candidate.mRadius = 0.5f * sqrtf(size.LengthSq()) * 1.0001f + 0.0625f;
+			candidate.mPartition = GetPartition(*mIndex, mTeam, candidate.mTarget.mFilter.mCategories);
+			candidate.mCell = 0;
+			sCandidates.push_back(candidate);
+		}
+	};
+
+	// gather the shapes of an entity
+	static void GatherTarget(Index &aIndex, unsigned int aId)
+	{
+		CollidableBody *body = Database::collidablebody.Get(aId);
+		if (!body)
+			return;
+
+		Gather gather;
+		gather.mIndex = &aIndex;
+		gather.mId = aId;
+		gather.mTeam = Database::team.Get(aId);
+		Collidable::EachShape(body, Collidable::EachShapeDelegate(&gather, &Gather::Add));
+	}
+
+	// does an entity belong in a shape set?
+	static bool IsMember(Set aSet, unsigned int aId)
+	{
+		if (aSet == TARGETS)
+			return Database::damagable.Find(aId) || Database::cancelable.Find(aId);
+		return true;
+	}
+
+	// rebuild an index from the physics world
+	static void Build(Set aSet)
+	{
+		PROFILE_ZONE("TargetIndex::Build");
+
+		Index &index = sIndex[aSet];
+
+		// gather the shapes of the set's entities
+		sCandidates.clear();
+		index.mPending.clear();
+		index.mExtra.clear();
+		index.mHasPending.store(false, std::memory_order_relaxed);
+		if (aSet == TARGETS)
+		{
+			for (Database::Typed<Damagable *>::Iterator itor(&Database::damagable); itor.IsValid(); ++itor)
+				GatherTarget(index, itor.GetKey());
+			for (Database::Typed<Cancelable *>::Iterator itor(&Database::cancelable); itor.IsValid(); ++itor)
+			{
+				if (!Database::damagable.Find(itor.GetKey()))
+					GatherTarget(index, itor.GetKey());
+			}
+		}
+		else
+		{
+			for (Database::Typed<CollidableBody *>::Iterator itor(&Database::collidablebody); itor.IsValid(); ++itor)
+				GatherTarget(index, itor.GetKey());
+		}
+
+		// size the grid to the target centers
+		AlignedBox2 extent(Vector2(FLT_MAX, FLT_MAX), Vector2(-FLT_MAX, -FLT_MAX));
+		for (std::vector<Candidate>::const_iterator itor = sCandidates.begin(); itor != sCandidates.end(); ++itor)
+		{
+			const Vector2 &center = itor->mTarget.mCenter;
+			extent.min.x = std::min(extent.min.x, center.x);
+			extent.min.y = std::min(extent.min.y, center.y);
+			extent.max.x = std::max(extent.max.x, center.x);
+			extent.max.y = std::max(extent.max.y, center.y);
+		}
+		if (sCandidates.empty())
+			extent = AlignedBox2(Vector2(0, 0), Vector2(0, 0));
+		const float sizex = extent.max.x - extent.min.x;
+		const float sizey = extent.max.y - extent.min.y;
+		const float cell = std::max(GRID_CELL_SIZE, std::max(sizex, sizey) / GRID_MAX_CELLS);
+		index.mOrigin = extent.min;
+		index.mScale = 1.0f / cell;
+		index.mWidth = GetCellIndex(sizex * index.mScale, GRID_MAX_CELLS) + 1;
+		index.mHeight = GetCellIndex(sizey * index.mScale, GRID_MAX_CELLS) + 1;
+		const int cells = index.mWidth * index.mHeight;
+
+		// count the targets in each cell of each partition
+		// (large targets count in the extra cell past the end)
+		for (unsigned int i = 0; i < index.mPartitions.size(); ++i)
+		{
+			Partition &partition = index.mPartitions[i];
+			partition.mReach = 0.0f;
+			partition.mCellStart.assign(cells + 2, 0);
+		}
+		for (std::vector<Candidate>::iterator itor = sCandidates.begin(); itor != sCandidates.end(); ++itor)
+		{
+			Partition &partition = index.mPartitions[itor->mPartition];
+			if (itor->mRadius > cell)
+			{
+				itor->mCell = cells;
+			}
+			else
+			{
+				const int x = GetCellIndex((itor->mTarget.mCenter.x - index.mOrigin.x) * index.mScale, index.mWidth);
+				const int y = GetCellIndex((itor->mTarget.mCenter.y - index.mOrigin.y) * index.mScale, index.mHeight);
+				itor->mCell = y * index.mWidth + x;
+				partition.mReach = std::max(partition.mReach, itor->mRadius);
+			}
+			++partition.mCellStart[itor->mCell + 1];
+		}
+
+		// convert counts to starting slots and fill the cells
+		// (in gathering order, so queries report targets in a repeatable order)
+		for (unsigned int i = 0; i < index.mPartitions.size(); ++i)
+		{
+			Partition &partition = index.mPartitions[i];
+			for (int c = 0; c <= cells; ++c)
+				partition.mCellStart[c + 1] += partition.mCellStart[c];
+			partition.mLarge = partition.mCellStart[cells];
+			const size_t count = partition.mCellStart[cells + 1];
+			partition.mTargets.resize(count);
+			partition.mX.resize(count);
+			partition.mY.resize(count);
+			partition.mRadius.resize(count);
+		}
+		index.mSlotRefs.clear();
+		for (unsigned int i = 0; i < index.mPartitions.size(); ++i)
+		{
+			Partition &partition = index.mPartitions[i];
+			sCursor.assign(partition.mCellStart.begin(), partition.mCellStart.end() - 1);
+			for (std::vector<Candidate>::const_iterator itor = sCandidates.begin(); itor != sCandidates.end(); ++itor)
+			{
+				if (itor->mPartition != i)
+					continue;
+				const unsigned int slot = sCursor[itor->mCell]++;
+				partition.mTargets[slot] = itor->mTarget;
+				partition.mX[slot] = itor->mTarget.mCenter.x;
+				partition.mY[slot] = itor->mTarget.mCenter.y;
+				partition.mRadius[slot] = itor->mRadius;
+				const SlotRef ref = { itor->mTarget.mId, i, slot };
+				index.mSlotRefs.push_back(ref);
+			}
+		}
+		std::sort(index.mSlotRefs.begin(), index.mSlotRefs.end(), CompareSlotRefs);
+	}
+
+	// gather bodies added since the build
+	// (partitions for teams or categories new since the build have no cells, so these
+	// only ever get checked as extra targets)
+	static void GatherPending(Set aSet)
+	{
+		Index &index = sIndex[aSet];
+		sCandidates.clear();
+		for (std::vector<unsigned int>::const_iterator itor = index.mPending.begin(); itor != index.mPending.end(); ++itor)
+		{
+			if (IsMember(aSet, *itor))
+				GatherTarget(index, *itor);
+		}
+		index.mExtra.insert(index.mExtra.end(), sCandidates.begin(), sCandidates.end());
+		index.mPending.clear();
+	}
+
+	// is an index current?
+	static bool IsCurrent(const Index &aIndex)
+	{
+		return aIndex.mRevision.load(std::memory_order_relaxed) == Collidable::GetRevision();
+	}
+
+	// a body entered the physics world or moved between steps
+	static void BodyAdded(unsigned int aId)
+	{
+		for (int set = 0; set < NUM_SETS; ++set)
+		{
+			// gather its shapes on the next query
+			// (a stale index gets rebuilt anyway)
+			Index &index = sIndex[set];
+			if (!IsCurrent(index))
+				continue;
+			index.mPending.push_back(aId);
+			index.mHasPending.store(true, std::memory_order_release);
+		}
+	}
+
+	// a body is leaving the physics world or moving between steps
+	static void BodyRemoved(unsigned int aId)
+	{
+		for (int set = 0; set < NUM_SETS; ++set)
+		{
+			Index &index = sIndex[set];
+			if (!IsCurrent(index))
+				continue;
+
+			// retire its grid slots
+			// (a bounding circle at infinity never overlaps a query)
+			const SlotRef key = { aId, 0, 0 };
+			for (std::vector<SlotRef>::iterator itor = std::lower_bound(index.mSlotRefs.begin(), index.mSlotRefs.end(), key, CompareSlotRefs);
+				 itor != index.mSlotRefs.end() && itor->mId == aId; ++itor)
+			{
+				Partition &partition = index.mPartitions[itor->mPartition];
+				partition.mTargets[itor->mSlot].mShape = NULL;
+				partition.mX[itor->mSlot] = FLT_MAX;
+				partition.mY[itor->mSlot] = FLT_MAX;
+				partition.mRadius[itor->mSlot] = 0.0f;
+				itor->mId = 0;
+			}
+
+			// drop its added shapes
+			for (size_t i = 0; i < index.mExtra.size(); )
+			{
+				if (index.mExtra[i].mTarget.mId == aId)
+					index.mExtra.erase(index.mExtra.begin() + i);
+				else
+					++i;
+			}
+			index.mPending.erase(std::remove(index.mPending.begin(), index.mPending.end(), aId), index.mPending.end());
+		}
+	}
+
+	// body change listener registration
+	static class Listener
+	{
+	public:
+		Listener()
+		{
+			Collidable::GetBodyAdded().Connect(BodyAdded);
+			Collidable::GetBodyRemoved().Connect(BodyRemoved);
+		}
+	} listener;
+
+	// rebuild an index if the physics world got stepped or replaced,
+	// and gather bodies added since
+	// (the first query after a change does it; concurrent queries wait for that)
+	static void Refresh(Set aSet)
+	{
+		Index &index = sIndex[aSet];
+		const unsigned int revision = Collidable::GetRevision();
+		if (index.mRevision.load(std::memory_order_acquire) != revision || index.mHasPending.load(std::memory_order_acquire))
+		{
+			std::lock_guard<std::mutex> lock(sBuildMutex);
+			if (index.mRevision.load(std::memory_order_relaxed) != revision)
+			{
+				Build(aSet);
+				index.mRevision.store(revision, std::memory_order_release);
+			}
+			else if (index.mHasPending.load(std::memory_order_relaxed))
+			{
+				GatherPending(aSet);
+				index.mHasPending.store(false, std::memory_order_release);
+			}
+		}
+	}
+
+	// get the angle of a target center from a query's cone direction
+	float GetConeAngle(const Query &aQuery, const Vector2 &aCenter)
+	{
+		// get local direction
+		const Vector2 localDir(aQuery.mConeTransform.Untransform(aCenter));
+
+		// get angle to target
+		const float aimAngle = -atan2f(localDir.x, localDir.y);
+
+		// get local angle
+		float localAngle = aimAngle - aQuery.mConeDirection;
+		if (localAngle > float(M_PI))
+			localAngle -= float(M_PI)*2.0f;
+		else if (localAngle < -float(M_PI))
+			localAngle += float(M_PI)*2.0f;
+		return localAngle;
+	}
+
+	// collect a target if the query reaches its shape
+	static inline void Report(const Target &aTarget, const Query &aQuery, size_t aIndex, std::vector<Hit> &aHits)
+	{
+		if (aTarget.mId == aQuery.mSkipId || !aTarget.mShape)
+			return;
+		if (!Collidable::CheckFilter(aQuery.mFilter, aTarget.mFilter))
+			return;
+		if (aQuery.mConeAngle < float(M_PI)*2.0f && fabsf(GetConeAngle(aQuery, aTarget.mCenter)) > aQuery.mConeAngle)
+			return;
+		Hit hit;
+		hit.mRange = Collidable::GetDistance(aTarget.mShape, aQuery.mCenter, hit.mPoint);
+		if (hit.mRange < aQuery.mRadius)
+		{
+			hit.mQuery = aIndex;
+			hit.mTarget = aTarget;
+			aHits.push_back(hit);
+		}
+	}
+
+	// collect targets in a slot range whose bounding circles the query overlaps
+	static void ReportSlots(const Partition &aPartition, unsigned int aBegin, unsigned int aEnd, const Query &aQuery, size_t aIndex, std::vector<Hit> &aHits)
+	{
+		// four bounding circles at a time
+		const __m128 cx = _mm_set_ps1(aQuery.mCenter.x);
+		const __m128 cy = _mm_set_ps1(aQuery.mCenter.y);
+		const __m128 radius = _mm_set_ps1(aQuery.mRadius);
+		unsigned int slot = aBegin;
+		for (; slot + 4 <= aEnd; slot += 4)
+		{
+			const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&aPartition.mX[slot]), cx);
+			const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&aPartition.mY[slot]), cy);
+			const __m128 reach = _mm_add_ps(_mm_loadu_ps(&aPartition.mRadius[slot]), radius);
+			const __m128 distsq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			const int mask = _mm_movemask_ps(_mm_cmplt_ps(distsq, _mm_mul_ps(reach, reach)));
+			if (mask == 0)
+				continue;
+			for (int i = 0; i < 4; ++i)
+			{
+				if (mask & (1 << i))
+					Report(aPartition.mTargets[slot + i], aQuery, aIndex, aHits);
+			}
+		}
+
+		// remaining bounding circles
+		for (; slot < aEnd; ++slot)
+		{
+			const float dx = aPartition.mX[slot] - aQuery.mCenter.x;
+			const float dy = aPartition.mY[slot] - aQuery.mCenter.y;
+			const float reach = aPartition.mRadius[slot] + aQuery.mRadius;
+			if (dx * dx + dy * dy < reach * reach)
+				Report(aPartition.mTargets[slot], aQuery, aIndex, aHits);
+		}
+	}
+
+	// collect the hits of a query
+	static void Collect(const Query &aQuery, size_t aIndex, std::vector<Hit> &aHits)
+	{
+		const Index &index = sIndex[aQuery.mSet];
+
+		for (std::vector<Partition>::const_iterator itor = index.mPartitions.begin(); itor != index.mPartitions.end(); ++itor)
+		{
+			const Partition &partition = *itor;
+
+			// skip excluded teams
+			if (aQuery.mSkipTeam && partition.mTeam == aQuery.mSkipTeam)
+				continue;
+			if (aQuery.mSkipNeutral && partition.mTeam == 0)
+				continue;
+
+			// skip partitions the filter mask excludes entirely
+			// (and partitions that showed up after the build)
+			if ((partition.mCategories & aQuery.mFilter.mMask) == 0 || partition.mCellStart.empty())
+				continue;
+
+			// gridded targets in cells the query and the largest target can reach
+			const float reach = aQuery.mRadius + partition.mReach;
+			const int x0 = GetCellIndex((aQuery.mCenter.x - reach - index.mOrigin.x) * index.mScale, index.mWidth);
+			const int y0 = GetCellIndex((aQuery.mCenter.y - reach - index.mOrigin.y) * index.mScale, index.mHeight);
+			const int x1 = GetCellIndex((aQuery.mCenter.x + reach - index.mOrigin.x) * index.mScale, index.mWidth);
+			const int y1 = GetCellIndex((aQuery.mCenter.y + reach - index.mOrigin.y) * index.mScale, index.mHeight);
+			for (int y = y0; y <= y1; ++y)
+			{
+				// cells in a row have consecutive slots
+				ReportSlots(partition, partition.mCellStart[y * index.mWidth + x0], partition.mCellStart[y * index.mWidth + x1 + 1], aQuery, aIndex, aHits);
+			}
+
+			// large targets
+			ReportSlots(partition, partition.mLarge, static_cast<unsigned int>(partition.mTargets.size()), aQuery, aIndex, aHits);
+		}
+
+		// targets added since the build
+		for (std::vector<Candidate>::const_iterator itor = index.mExtra.begin(); itor != index.mExtra.end(); ++itor)
+		{
+			const Target &target = itor->mTarget;
+			if (aQuery.mSkipTeam && target.mTeam == aQuery.mSkipTeam)
+				continue;
+			if (aQuery.mSkipNeutral && target.mTeam == 0)
+				continue;
+			const Vector2 dir(target.mCenter - aQuery.mCenter);
+			const float reach = itor->mRadius + aQuery.mRadius;
+			if (dir.LengthSq() < reach * reach)
+				Report(target, aQuery, aIndex, aHits);
+		}
+	}
+
+	// query all targets within radius of a point
+	void QueryRadius(const Query &aQuery, QueryDelegate aDelegate)
+	{
+		Refresh(aQuery.mSet);
+
+		// find every hit before reporting any
+		// (reports may kill targets and free their shapes)
+		std::vector<Hit> hits;
+		Collect(aQuery, 0, hits);
+
+		// report hits
+		for (std::vector<Hit>::const_iterator itor = hits.begin(); itor != hits.end(); ++itor)
+			aDelegate(itor->mTarget, itor->mRange, itor->mPoint);
+	}
+
+	// query all targets within radius of each of several points
+	void QueryRadiusBatch(const Query *aQueries, size_t aCount, BatchDelegate aDelegate)
+	{
+		// refresh the sets the queries search
+		bool refreshed[NUM_SETS] = { false };
+		for (size_t i = 0; i < aCount; ++i)
+		{
+			if (!refreshed[aQueries[i].mSet])
+			{
+				Refresh(aQueries[i].mSet);
+				refreshed[aQueries[i].mSet] = true;
+			}
+		}
+
+		// find every hit of every query before reporting any
+		std::vector<Hit> hits;
+		for (size_t i = 0; i < aCount; ++i)
+			Collect(aQueries[i], i, hits);
+
+		// report hits
+		for (std::vector<Hit>::const_iterator itor = hits.begin(); itor != hits.end(); ++itor)
+			aDelegate(itor->mQuery, itor->mTarget, itor->mRange, itor->mPoint);
+	}
+}
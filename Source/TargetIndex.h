@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Collidable.h"
+
+// target index
+// (the shapes of damagable and cancelable entities, gathered into a uniform grid per team and
+// category once per physics step and patched as bodies come and go between steps, so target and
+// area queries skip the physics world's index and the per-shape database lookups)
+namespace TargetIndex
+{
+	// indexed shape sets
+	enum Set
+	{
+		TARGETS,	// shapes of damagable and cancelable entities
+		ENTITIES,	// shapes of every entity with a body (built by the first query that asks for it)
+		NUM_SETS
+	};
+
+	// indexed target shape
+	struct Target
+	{
+		unsigned int mId;
+		unsigned int mTeam;
+		CollidableFilter mFilter;
+		CollidableShape *mShape;
+		Vector2 mCenter;
+	};
+
+	// radius query
+	struct Query
+	{
+		Query(const Vector2 &aCenter, float aRadius, const CollidableFilter &aFilter)
+			: mCenter(aCenter)
+			, mRadius(aRadius)
+			, mFilter(aFilter)
+			, mSet(TARGETS)
+			, mSkipId(0)
+			, mSkipTeam(0)
+			, mSkipNeutral(false)
+			, mConeTransform(Transform2::Identity())
+			, mConeDirection(0.0f)
+			, mConeAngle(float(M_PI) * 2.0f)
+		{
+		}
+
+		// limit the query to a cone
+		// (target centers within an angle of a direction in the cone transform's frame)
+		void SetCone(const Transform2 &aTransform, float aDirection, float aAngle)
+		{
+			mConeTransform = aTransform;
+			mConeDirection = aDirection;
+			mConeAngle = aAngle;
+		}
+
+		Vector2 mCenter;
+		float mRadius;
+		CollidableFilter mFilter;
+		Set mSet;				// shape set to search
+		unsigned int mSkipId;	// identifier to skip (zero for none)
+		unsigned int mSkipTeam;	// team to skip (zero for none)
+		bool mSkipNeutral;		// skip targets without a team
+		Transform2 mConeTransform;	// cone frame
+		float mConeDirection;	// cone direction angle in the cone frame
+		float mConeAngle;		// cone half-angle (a full turn or more for no cone)
+	};
+
+	// get the angle of a target center from a query's cone direction
+	// (in the range -pi to pi)
+	GAME_API float GetConeAngle(const Query &aQuery, const Vector2 &aCenter);
+
+	// query all targets within radius of a point
+	// (reports every shape nearer than the radius, like Collidable::QueryRadius does, minus sensors and filtered shapes;
+	// finds every hit before reporting any, so the delegate may damage or remove targets, though the shapes
+	// of targets it removes are gone by the time their remaining hits get reported;
+	// safe from worker threads while nothing changes the physics world)
+	typedef fastdelegate::FastDelegate<void (const Target &aTarget, float aRange, const Vector2 &aPoint)> QueryDelegate;
+	GAME_API void QueryRadius(const Query &aQuery, QueryDelegate aDelegate);
+
+	// query all targets within radius of each of several points
+	// (like QueryRadius for each query in turn, but finds the hits of every query before reporting any,
+	// and reports them grouped by query in query order)
+	typedef fastdelegate::FastDelegate<void (size_t aQuery, const Target &aTarget, float aRange, const Vector2 &aPoint)> BatchDelegate;
+	GAME_API void QueryRadiusBatch(const Query *aQueries, size_t aCount, BatchDelegate aDelegate);
+}
@@ -1,11 +1,17 @@
 #include "StdAfx.h"
 #include "Team.h"
+#include "Snapshot.h"
 
 namespace Database
 {
 	// team identifier database
 	Typed<unsigned int> team(0xa2fd7d0c /* "team" */);
 
+	namespace Serializer
+	{
+		Snapshot::Serializer::Plain teamserializer(0xa2fd7d0c /* "team" */);
+	}
+
 	namespace Loader
 	{
 		static void TeamConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
@@ -49,10 +49,16 @@ std::string INPUT_CONFIG = "input/default.xml";
 std::string LEVEL_CONFIG = "level.xml";
 
 // default record configuration
-std::string RECORD_CONFIG = "record.xml";
+std::string RECORD_CONFIG = "record.jrn";
 bool record = false;
 bool playback = false;
 
+// record world state digests
+bool JOURNAL_DIGEST = false;
+
+// headless simulation
+bool headless = false;
+
 // runtime
 bool runtime = false;
 
@@ -326,6 +332,10 @@ int main( int argc, char *argv[] )
 		}
 	}
 
+	// run without a window if requested
+	if (headless)
+		return RunHeadless();
+
 	// initialize
 	if( !Init() )
 		return 1;    
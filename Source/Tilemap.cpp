@@ -58,12 +58,30 @@ public:
 		mInstance = static_cast<unsigned int *>(malloc(aTemplate.mCount * sizeof(unsigned int)));
 		mCount = aTemplate.mCount;
 
+		// get tile transforms
+		Transform2 *spawn = static_cast<Transform2 *>(malloc(mCount * sizeof(Transform2)));
 		for (size_t i = 0; i < mCount; ++i)
+			spawn[i] = aTemplate.mMap[i].mOffset * transform;
+
+		// instantiate runs of tiles with the same spawn template as a batch
+		for (size_t start = 0; start < mCount; )
 		{
-			const Tile &tile = aTemplate.mMap[i];
-			const Transform2 spawn(tile.mOffset * transform);
+			size_t end = start + 1;
+			while (end < mCount && aTemplate.mMap[end].mSpawn == aTemplate.mMap[start].mSpawn)
+				++end;
+			Database::InstantiateBatch(aTemplate.mMap[start].mSpawn, mId, mId, end - start, spawn + start, NULL, mInstance + start);
+			start = end;
+		}
+
+		free(spawn);
 
-			mInstance[i] = Database::Instantiate(tile.mSpawn, mId, mId, spawn.a, spawn.p);
+		for (size_t i = 0; i < mCount; ++i)
+		{
+			// skip tiles a snapshot restore left out
+			if (!mInstance[i])
+				continue;
+
+			const Tile &tile = aTemplate.mMap[i];
 
 			if (mId)
 			{
@@ -109,7 +127,8 @@ public:
 	{
 		for (size_t i = 0; i < mCount; ++i)
 		{
-			Database::Delete(mInstance[i]);
+			if (mInstance[i])
+				Database::Delete(mInstance[i]);
 		}
 
 		free(mInstance);
@@ -10,6 +10,7 @@ public:
 	CollidableFilter mFilter;
 	float mLinearDamping;
 	float mAngularDamping;
+	float mRadius;
 
 public:
 	TraceTemplate();
@@ -17,35 +18,56 @@ public:
 	void Configure(const tinyxml2::XMLElement *element, unsigned int id);
 };
 
-class Trace : public Updatable
+// trace set
+// (traces have no physics body: they live in parallel arrays and get swept
+// against the physics world together, once per turn, in activation order;
+// removed traces leave a zero identifier until the next sweep compacts them;
+// removing the last trace outside a sweep releases the set and its sweep update,
+// so nothing outlives the instances when the databases get cleaned up;
+// a trace added after this turn's sweep re-queues the sweep, which then
+// picks up from the cursor, so it still moves this turn like its own update would)
+namespace Trace
 {
-public:
-#ifdef USE_POOL_ALLOCATOR
-	// allocation
-	void *operator new(size_t aSize);
-	void operator delete(void *aPtr);
-#endif
-
-	Trace(const TraceTemplate &aTemplate, unsigned int aId);
+	static std::vector<unsigned int> sId;
+	static std::vector<CollidableFilter> sFilter;
+	static std::vector<float> sLinearDamping;
+	static std::vector<float> sAngularDamping;
+	static std::vector<float> sRadius;
+	static size_t sCount;
+	static bool sDirty;
+	static bool sSweeping;
+	static size_t sCursor;
+	static unsigned int sSweptTurn = ~0U;
+	static bool sQueued;
 
-	void Update(float aStep);
-};
+	// add a trace
+	static void Add(const TraceTemplate &aTemplate, unsigned int aId);
 
+	// remove a trace
+	static void Remove(unsigned int aId);
 
+	// sweep all traces
+	static void SweepAll(float aStep);
 
-#ifdef USE_POOL_ALLOCATOR
-
-// particle pool
-static MemoryPool sPool(sizeof(Trace));
-void *Trace::operator new(size_t aSize)
-{
-	return sPool.Alloc();
+	// release the trace set
+	static void Clear(void);
 }
-void Trace::operator delete(void *aPtr)
+
+// trace sweep update
+// (exists while there are traces to sweep)
+class TraceSweep : public Updatable
 {
-	sPool.Free(aPtr);
-}
-#endif
+public:
+	TraceSweep(void)
+		: Updatable(0)
+	{
+		SetAction(Action(this, &TraceSweep::Update));
+		Activate();
+	}
+
+	void Update(float aStep);
+};
+static TraceSweep *sSweep;
 
 
 extern void ConfigureFilterData(CollidableFilter &aFilter, const tinyxml2::XMLElement *element);
@@ -54,7 +76,7 @@ extern void ConfigureFilterData(CollidableFilter &aFilter, const tinyxml2::XMLEl
 namespace Database
 {
 	Typed<TraceTemplate> tracetemplate(0x9e24e600 /* "tracetemplate" */);
-	Typed<Trace *> trace(0x813d75ae /* "trace" */);
+	Typed<unsigned int> trace(0x813d75ae /* "trace" */);
 
 	namespace Loader
 	{
@@ -72,18 +94,13 @@ namespace Database
 		static void TraceActivate(unsigned int aId)
 		{
 			const TraceTemplate &tracetemplate = Database::tracetemplate.Get(aId);
-			Trace *trace = new Trace(tracetemplate, aId);
-			Database::trace.Put(aId, trace);
+			Trace::Add(tracetemplate, aId);
 		}
 		Activate traceactivate(0x9e24e600 /* "tracetemplate" */, TraceActivate);
 
 		static void TraceDeactivate(unsigned int aId)
 		{
-			if (Trace *trace = Database::trace.Get(aId))
-			{
-				delete trace;
-				Database::trace.Delete(aId);
-			}
+			Trace::Remove(aId);
 		}
 		Deactivate tracedeactivate(0x9e24e600 /* "tracetemplate" */, TraceDeactivate);
 	}
@@ -94,12 +111,14 @@ TraceTemplate::TraceTemplate(void)
 	: mFilter()
 	, mLinearDamping(0.0f)
 	, mAngularDamping(0.0f)
+	, mRadius(0.0f)
 {
 }
 
 void TraceTemplate::Configure(const tinyxml2::XMLElement *element, unsigned int id)
 {
 	ConfigureFilterData(mFilter, element);
+	element->QueryFloatAttribute("radius", &mRadius);
 
 	// process child elements
 	for (const tinyxml2::XMLElement *child = element->FirstChildElement(); child != NULL; child = child->NextSiblingElement())
@@ -113,35 +132,141 @@ void TraceTemplate::Configure(const tinyxml2::XMLElement *element, unsigned int
 	}
 }
 
-Trace::Trace(const TraceTemplate &aTemplate, unsigned int aId)
-	: Updatable(aId)
+// add a trace
+void Trace::Add(const TraceTemplate &aTemplate, unsigned int aId)
+{
+	Database::trace.Put(aId, static_cast<unsigned int>(sId.size()));
+	sId.push_back(aId);
+	sFilter.push_back(aTemplate.mFilter);
+	sLinearDamping.push_back(aTemplate.mLinearDamping);
+	sAngularDamping.push_back(aTemplate.mAngularDamping);
+	sRadius.push_back(aTemplate.mRadius);
+	++sCount;
+
+	// start sweeping
+	if (!sSweep)
+	{
+		sSweep = new TraceSweep();
+	}
+	else if (!sSweeping && !sQueued && sSweptTurn == sim_turn)
+	{
+		// re-queue the sweep so the next update pass picks up late additions
+		sSweep->Deactivate();
+		sSweep->Activate();
+		sQueued = true;
+	}
+}
+
+// remove a trace
+void Trace::Remove(unsigned int aId)
+{
+	if (const unsigned int *index = Database::trace.Find(aId))
+	{
+		sId[*index] = 0;
+		sDirty = true;
+		Database::trace.Delete(aId);
+
+		// release the set once the last trace is gone
+		// (a sweep in progress releases it when done)
+		if (--sCount == 0 && !sSweeping)
+			Clear();
+	}
+}
+
+// release the trace set
+void Trace::Clear(void)
 {
-	SetAction(Action(this, &Trace::Update));
-	Activate();
+	sId.clear();
+	sFilter.clear();
+	sLinearDamping.clear();
+	sAngularDamping.clear();
+	sRadius.clear();
+	sCount = 0;
+	sDirty = false;
+	sCursor = 0;
+	sSweptTurn = ~0U;
+	sQueued = false;
+
+	// stop sweeping
+	if (sSweep)
+	{
+		sSweep->Deactivate();
+		delete sSweep;
+		sSweep = NULL;
+	}
 }
 
-void Trace::Update(float aStep)
+// sweep all traces
+void Trace::SweepAll(float aStep)
 {
-	if (Entity *entity = Database::entity.Get(mId))
+	// another pass this turn only sweeps traces added since the last one
+	size_t start = 0;
+	if (sSweptTurn == sim_turn)
 	{
-		const TraceTemplate &trace = Database::tracetemplate.Get(mId);
+		start = sCursor;
+	}
+
+	// compact removed traces
+	// (keeps activation order; only before the first pass of a turn,
+	// since compacting would move the cursor)
+	else if (sDirty)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < sId.size(); ++i)
+		{
+			if (const unsigned int id = sId[i])
+			{
+				if (count != i)
+				{
+					Database::trace.Put(id, static_cast<unsigned int>(count));
+					sId[count] = id;
+					sFilter[count] = sFilter[i];
+					sLinearDamping[count] = sLinearDamping[i];
+					sAngularDamping[count] = sAngularDamping[i];
+					sRadius[count] = sRadius[i];
+				}
+				++count;
+			}
+		}
+		sId.resize(count);
+		sFilter.resize(count);
+		sLinearDamping.resize(count);
+		sAngularDamping.resize(count);
+		sRadius.resize(count);
+		sDirty = false;
+	}
+
+	// for each trace...
+	// (indices stay valid while contacts add and remove traces:
+	// adding appends, and removing leaves a zero identifier)
+	sSweptTurn = sim_turn;
+	sQueued = false;
+	for (size_t i = start; i < sId.size(); ++i)
+	{
+		const unsigned int id = sId[i];
+		if (!id)
+			continue;
+
+		Entity *entity = Database::entity.Get(id);
+		if (!entity)
+			continue;
 
 		entity->Step();
 
 		// apply damping
-		entity->SetVelocity(entity->GetVelocity() * (1.0f - trace.mLinearDamping * aStep));
-		entity->SetOmega(entity->GetOmega() * (1.0f - trace.mAngularDamping * aStep));
+		entity->SetVelocity(entity->GetVelocity() * (1.0f - sLinearDamping[i] * aStep));
+		entity->SetOmega(entity->GetOmega() * (1.0f - sAngularDamping[i] * aStep));
 
 		// get start and end points
 		Transform2 start(entity->GetTransform());
 		Transform2 end(start.a + aStep * entity->GetOmega(), start.p + aStep * entity->GetVelocity());
 
-		// perform segment test
+		// perform segment or circle test
 		float lambda;
 		Vector2 normal;
 		CollidableShape *shape;
-		unsigned int hitId = Collidable::TestSegment(start.p, end.p, trace.mFilter, mId, lambda, normal, shape);
-		
+		unsigned int hitId = Collidable::TestSegment(start.p, end.p, sFilter[i], id, lambda, normal, shape, sRadius[i]);
+
 		// if the segment hit something...
 		if (lambda < 1.0f)
 		{
@@ -153,8 +278,8 @@ void Trace::Update(float aStep)
 			entity->SetTransform(end);
 
 			// signal contact add
-			Database::collidablecontactadd.Get(mId)(mId, hitId, 0.0f, end.p, normal);
-			Database::collidablecontactadd.Get(hitId)(hitId, mId, 0.0f, end.p, normal);
+			Database::collidablecontactadd.Get(id)(id, hitId, 0.0f, end.p, normal);
+			Database::collidablecontactadd.Get(hitId)(hitId, id, 0.0f, end.p, normal);
 		}
 		else
 		{
@@ -162,4 +287,19 @@ void Trace::Update(float aStep)
 			entity->SetTransform(end);
 		}
 	}
+
+	// remember where this pass stopped
+	sCursor = sId.size();
+}
+
+void TraceSweep::Update(float aStep)
+{
+	Trace::sSweeping = true;
+	Trace::SweepAll(aStep);
+	Trace::sSweeping = false;
+
+	// stop sweeping once all traces are gone
+	// (deletes this update)
+	if (Trace::sCount == 0)
+		Trace::Clear();
 }
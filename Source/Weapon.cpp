@@ -10,6 +10,7 @@
 #include "Resource.h"
 #include "Interpolator.h"
 #include "Variable.h"
+#include "Snapshot.h"
 
 #include "ExpressionConfigure.h"
 #include "ExpressionAction.h"
@@ -112,6 +113,33 @@ namespace Database
 	Typed<Weapon *> weapon(0x6f332041 /* "weapon" */);
 	Typed<WeaponTracker> weapontracker(0x49c0728f /* "weapontracker" */);
 
+	namespace Serializer
+	{
+		static void WeaponSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			Database::weapon.Get(aId)->Save(aWriter);
+		}
+		static void WeaponRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			if (Weapon *weapon = Database::weapon.Get(aId))
+				weapon->Restore(aReader);
+		}
+		Snapshot::Serializer::Custom weaponserializer(0x6f332041 /* "weapon" */, WeaponSave, WeaponRestore);
+
+		// trackers are put again so they count against their weapon
+		static void WeaponTrackerSave(unsigned int aId, Snapshot::Writer &aWriter)
+		{
+			aWriter.Write(Database::weapontracker.Get(aId).mId);
+		}
+		static void WeaponTrackerRestore(unsigned int aId, Snapshot::Reader &aReader)
+		{
+			unsigned int aWeaponId = 0;
+			if (aReader.Read(aWeaponId))
+				Database::weapontracker.Put(aId, WeaponTracker(aWeaponId));
+		}
+		Snapshot::Serializer::Custom weapontrackerserializer(0x49c0728f /* "weapontracker" */, WeaponTrackerSave, WeaponTrackerRestore);
+	}
+
 	namespace Loader
 	{
 		static void WeaponConfigure(unsigned int aId, const tinyxml2::XMLElement *element)
@@ -283,6 +311,8 @@ static void WeaponOrdnance(EntityContext &aContext)
 	velocity.p = position.Rotate(velocity.p);
 
 	// instantiate a bullet
+	// (one shot at a time: each activates and registers its tracker before the next
+	// gets evaluated, keeping random draws in firing order and the track limit per shot)
 	if (unsigned int ordId = Database::Instantiate(ordnance, Database::owner.Get(aContext.mId), aContext.mId, position.a, position.p, velocity.p, velocity.a))
 	{
 #ifdef DEBUG_WEAPON_CREATE_ORDNANCE
@@ -882,6 +912,60 @@ Weapon::~Weapon(void)
 {
 }
 
+// weapon update actions, in snapshot order
+enum WeaponAction
+{
+	WEAPON_NONE,
+	WEAPON_READY,
+	WEAPON_ACTION,
+	WEAPON_DELAY,
+};
+
+// save snapshot state
+// (the tracking count is rebuilt as trackers are restored)
+void Weapon::Save(Snapshot::Writer &aWriter) const
+{
+	int action = WEAPON_NONE;
+	if (GetAction() == Action(const_cast<Weapon *>(this), &Weapon::UpdateReady))
+		action = WEAPON_READY;
+	else if (GetAction() == Action(const_cast<Weapon *>(this), &Weapon::UpdateAction))
+		action = WEAPON_ACTION;
+	else if (GetAction() == Action(const_cast<Weapon *>(this), &Weapon::UpdateDelay))
+		action = WEAPON_DELAY;
+
+	aWriter.Write(action);
+	aWriter.Write(mControlId);
+	aWriter.Write(mPrevFire);
+	aWriter.Write(static_cast<unsigned int>(mIndex));
+	aWriter.Write(mTimer);
+	aWriter.Write(mLocal);
+	aWriter.Write(mPhase);
+}
+
+// restore snapshot state
+void Weapon::Restore(Snapshot::Reader &aReader)
+{
+	int action = WEAPON_NONE;
+	unsigned int index = 0;
+	aReader.Read(action);
+	aReader.Read(mControlId);
+	aReader.Read(mPrevFire);
+	aReader.Read(index);
+	aReader.Read(mTimer);
+	aReader.Read(mLocal);
+	aReader.Read(mPhase);
+	mIndex = index;
+
+	switch (action)
+	{
+	default:
+	case WEAPON_NONE: SetAction(Action(this, &Weapon::UpdateNone)); break;
+	case WEAPON_READY: SetAction(Action(this, &Weapon::UpdateReady)); break;
+	case WEAPON_ACTION: SetAction(Action(this, &Weapon::UpdateAction)); break;
+	case WEAPON_DELAY: SetAction(Action(this, &Weapon::UpdateDelay)); break;
+	}
+}
+
 // weapon none update
 void Weapon::UpdateNone(float aStep)
 {
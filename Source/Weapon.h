@@ -43,6 +43,12 @@ public:
 	bool Configure(const tinyxml2::XMLElement *element, unsigned int aId);
 };
 
+namespace Snapshot
+{
+	class Writer;
+	class Reader;
+}
+
 class Weapon
 	: public Updatable
 {
@@ -93,6 +99,10 @@ public:
 	void UpdateAction(float aStep);
 	void UpdateDelay(float aStep);
 
+	// snapshot
+	void Save(Snapshot::Writer &aWriter) const;
+	void Restore(Snapshot::Reader &aReader);
+
 protected:
 	friend class WeaponTracker;
 
@@ -42,6 +42,7 @@
 
 #define COLLECT_DEBUG_DRAW
 #define COLLIDABLE_DEBUG_DRAW
+#define COLLIDABLE_HASTY_SPACE
 
 const int AUDIO_FREQUENCY = 48000;
 
@@ -123,6 +124,12 @@ extern bool PROFILER_OUTPUTPRINT;
 extern bool FRAMERATE_OUTPUTSCREEN;
 extern bool FRAMERATE_OUTPUTPRINT;
 
+// database statistics
+extern bool DATABASE_OUTPUTSCREEN;
+
+// render statistics
+extern bool RENDER_OUTPUTSCREEN;
+
 // debug draw
 extern bool DEBUG_DRAW;
 
@@ -131,6 +138,9 @@ extern int SIMULATION_RATE;
 extern float TIME_SCALE;
 extern bool FIXED_STEP;
 
+// worker threads for the control phase
+extern int CONTROL_THREADS;
+
 // rendering attributes
 extern int MOTIONBLUR_STEPS;
 extern float MOTIONBLUR_TIME;
@@ -154,6 +164,15 @@ extern std::string RECORD_CONFIG;
 extern bool record;
 extern bool playback;
 
+// record world state digests to check playback determinism
+extern bool JOURNAL_DIGEST;
+
+// headless simulation (no window, rendering, or audio)
+extern bool headless;
+extern int HEADLESS_TURNS;
+extern unsigned int HEADLESS_BENCHMARK_SPAWN;
+extern int HEADLESS_BENCHMARK_COUNT;
+
 // runtime
 extern bool runtime;
 